@@ -22,10 +22,186 @@
 #ifndef _ARRAY_LOOKUP_H_
 #define _ARRAY_LOOKUP_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
+/* int_btree_index_build() / float_btree_index_build() flags */
+#define SEARCH_INDEX_HUGE_PAGES   0x1   /* back the tree with 2 MiB pages where available */
+#define SEARCH_TREE_MAX_HEIGHT    12
+
 int int_array_lookup(int *arr, int size, int target);
 float float_array_lookup(float *arr, int size, float target);
 void* pointer_array_lookup(void **arr, int size, void *target);
 int binary_search_int(int *arr, int size, int target);
 float binary_search_float(float *arr, int size, float target);
 
+/*
+ * Typed searches with size_t lengths, generated for int, uint32_t,
+ * int64_t, uint64_t, float and double (suffixes int, uint32, int64,
+ * uint64, float, double), e.g. array_lower_bound_int64(). Positions are
+ * size_t; a miss is ARRAY_NPOS.
+ *
+ *   array_lookup_T         first match of a linear (SIMD) scan
+ *   array_binary_search_T  first match in a sorted array
+ *   array_lower_bound_T    first element >= target, or size
+ *   array_upper_bound_T    first element > target, or size
+ *   array_equal_range_T    number of elements equal to target; *first
+ *                          receives the lower bound
+ *
+ * The sorted-array functions compare with '<', so a NaN target matches
+ * nothing.
+ */
+#define ARRAY_NPOS ((size_t)-1)
+
+#define ARRAY_TYPED_SEARCH_DECLARE(sfx, T)                                     \
+   size_t array_lookup_##sfx(const T *arr, size_t size, T target);             \
+   size_t array_binary_search_##sfx(const T *arr, size_t size, T target);      \
+   size_t array_lower_bound_##sfx(const T *arr, size_t size, T target);        \
+   size_t array_upper_bound_##sfx(const T *arr, size_t size, T target);        \
+   size_t array_equal_range_##sfx(const T *arr, size_t size, T target, size_t *first);
+
+ARRAY_TYPED_SEARCH_DECLARE(int, int)
+ARRAY_TYPED_SEARCH_DECLARE(uint32, uint32_t)
+ARRAY_TYPED_SEARCH_DECLARE(int64, int64_t)
+ARRAY_TYPED_SEARCH_DECLARE(uint64, uint64_t)
+ARRAY_TYPED_SEARCH_DECLARE(float, float)
+ARRAY_TYPED_SEARCH_DECLARE(double, double)
+
+/*
+ * Parallel linear scans for very large unsorted arrays. The array is cut
+ * into chunks of at least 'min_chunk' elements (0 selects the default)
+ * that up to 'threads' threads (0 or less: one per online CPU) scan with
+ * the same SIMD kernels, using an internal worker pool. A match lets the
+ * other threads stop early, and the result is still the first match.
+ * Arrays shorter than two chunks are scanned on the calling thread.
+ */
+#define ARRAY_PAR_MIN_CHUNK  (1 << 18)
+
+size_t int_array_lookup_par(const int *arr, size_t size, int target, int threads,
+                            size_t min_chunk);
+size_t float_array_lookup_par(const float *arr, size_t size, float target, int threads,
+                              size_t min_chunk);
+void* pointer_array_lookup_par(void *const *arr, size_t size, void *target, int threads,
+                               size_t min_chunk);
+
+/*
+ * Branchless bisection over the same sorted arrays. Every step is a
+ * conditional move rather than a branch, and both possible next probes
+ * are prefetched. Returns the index of the first match or -1.
+ */
+int binary_search_int_branchless(int *arr, int size, int target);
+int binary_search_float_branchless(float *arr, int size, float target);
+
+/*
+ * Batched searches over a sorted array: out[i] receives the index of
+ * queries[i] (its first occurrence) or -1. Up to 16 queries descend in
+ * lockstep and each one's next probe is prefetched, so their cache misses
+ * overlap. The _sorted variants first sort a copy of the queries and then
+ * gallop forward from the previous answer, which suits many queries that
+ * cluster in a large array.
+ */
+void binary_search_int_batch(int *arr, int size, const int *queries, int count, int *out);
+void binary_search_float_batch(float *arr, int size, const float *queries, int count, int *out);
+void binary_search_int_batch_sorted(int *arr, int size, const int *queries, int count, int *out);
+void binary_search_float_batch_sorted(float *arr, int size, const float *queries, int count,
+                                      int *out);
+
+/*
+ * Build-once search index over a sorted array. The keys are copied in
+ * Eytzinger (BFS) order, so the first levels of every search share the
+ * same few cache lines and the next four levels of a descent sit in one
+ * line that is prefetched ahead. Lookups return the position in the
+ * original array, or -1. Arrays of 2^30 or more elements are refused
+ * (the build returns NULL).
+ */
+typedef struct IntSearchIndex {
+   int *keys;
+   int *positions;
+   int size;
+} IntSearchIndex;
+
+typedef struct FloatSearchIndex {
+   float *keys;
+   int *positions;
+   int size;
+} FloatSearchIndex;
+
+IntSearchIndex* int_search_index_build(int *arr, int size);
+int int_search_index_find(const IntSearchIndex *index, int target);
+void int_search_index_free(IntSearchIndex *index);
+FloatSearchIndex* float_search_index_build(float *arr, int size);
+int float_search_index_find(const FloatSearchIndex *index, float target);
+void float_search_index_free(FloatSearchIndex *index);
+
+/*
+ * Static B+ tree (S+ tree) over a sorted array, for arrays too large for
+ * the Eytzinger index to stay cache-friendly. Nodes hold 16 keys, one
+ * 64-byte line for int and float, and are ranked with a few SIMD compares
+ * and a popcount. A descent costs about log17(n) cache misses. The leaf
+ * layer is the sorted array itself, padded to whole nodes, so results are
+ * positions in the original array.
+ *
+ * lower_bound returns the first position whose element is >= target, or
+ * 'size' if there is none. range_count counts elements in [lo, hi).
+ */
+typedef struct IntBTreeIndex {
+   int *keys;
+   int size;
+   int height;
+   size_t offsets[SEARCH_TREE_MAX_HEIGHT];
+   size_t mapped;
+} IntBTreeIndex;
+
+typedef struct FloatBTreeIndex {
+   float *keys;
+   int size;
+   int height;
+   size_t offsets[SEARCH_TREE_MAX_HEIGHT];
+   size_t mapped;
+} FloatBTreeIndex;
+
+IntBTreeIndex* int_btree_index_build(int *arr, int size, int flags);
+int int_btree_index_find(const IntBTreeIndex *index, int target);
+int int_btree_index_lower_bound(const IntBTreeIndex *index, int target);
+int int_btree_index_range_count(const IntBTreeIndex *index, int lo, int hi);
+void int_btree_index_free(IntBTreeIndex *index);
+FloatBTreeIndex* float_btree_index_build(float *arr, int size, int flags);
+int float_btree_index_find(const FloatBTreeIndex *index, float target);
+int float_btree_index_lower_bound(const FloatBTreeIndex *index, float target);
+int float_btree_index_range_count(const FloatBTreeIndex *index, float lo, float hi);
+void float_btree_index_free(FloatBTreeIndex *index);
+
+/*
+ * Learned index (PGM style) over a sorted int array. The distinct keys are
+ * covered by linear segments, each predicting a key's position to within
+ * 'epsilon' slots, so a lookup is a search over the few segment keys, one
+ * multiply-add and a bisection of at most 2 * epsilon + 2 elements. Near
+ * uniform data (timestamps, dense IDs) needs only a handful of segments;
+ * heavily clustered or skewed data needs more, and past roughly n / 64
+ * segments the Eytzinger or B+ tree index is the better choice.
+ *
+ * The index refers to 'arr' rather than copying it, so the array must
+ * outlive the index and stay unmodified. epsilon <= 0 selects the default.
+ * Lookups return the first position of the target, or -1.
+ */
+#define LEARNED_INDEX_EPSILON     32
+
+typedef struct LearnedSegment {
+   int key;         /* first key covered */
+   int position;    /* its first position in the array */
+   double slope;
+} LearnedSegment;
+
+typedef struct IntLearnedIndex {
+   const int *arr;
+   int size;
+   int epsilon;
+   LearnedSegment *segments;
+   int segment_count;
+} IntLearnedIndex;
+
+IntLearnedIndex* int_learned_index_build(int *arr, int size, int epsilon);
+int int_learned_index_find(const IntLearnedIndex *index, int target);
+void int_learned_index_free(IntLearnedIndex *index);
+
 #endif /* _ARRAY_LOOKUP_H_ */
@@ -0,0 +1,47 @@
+/*
+ * lookup/concurrent_hash_lookup.h - Thread-safe hash table
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _CONCURRENT_HASH_LOOKUP_H_
+#define _CONCURRENT_HASH_LOOKUP_H_
+
+/*
+ * Hash table safe for any mix of concurrent readers and writers.
+ *
+ * concurrent_hash_lookup() takes no locks: it walks immutable chain nodes
+ * published with release stores, and nodes or bucket arrays unlinked by
+ * writers are only freed once every reader that could still see them has
+ * left its epoch. Writers serialize per lock stripe. Growing the bucket
+ * array is spread over subsequent writes, bucket by bucket, while readers
+ * and writers keep running.
+ *
+ * concurrent_hash_table_free() must not race with any other call on the
+ * same table.
+ */
+typedef struct ConcurrentHashTable ConcurrentHashTable;
+
+ConcurrentHashTable* concurrent_hash_table_create(int capacity);
+int concurrent_hash_lookup(ConcurrentHashTable *table, const char *key, void **value);
+int concurrent_hash_insert(ConcurrentHashTable *table, const char *key, void *value);
+int concurrent_hash_remove(ConcurrentHashTable *table, const char *key);
+int concurrent_hash_size(ConcurrentHashTable *table);
+void concurrent_hash_table_free(ConcurrentHashTable *table);
+
+#endif /* _CONCURRENT_HASH_LOOKUP_H_ */
@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <fcntl.h>
+#include <stdint.h>
 #include <unistd.h>
 
 #ifdef __APPLE__
@@ -36,7 +37,121 @@
    #define PLATFORM_ELF   1
 #endif
 
+/*
+ * find_symbol_in_executable_ex() flags. Without EXEC_LOOKUP_SYMTAB only
+ * the dynamic symbols are consulted, through the binary's .gnu.hash or
+ * SysV hash table, which works on stripped binaries and touches a handful
+ * of cache lines. With it, a miss falls back to scanning .symtab, which
+ * also finds local symbols. find_symbol_in_executable() and
+ * parse_exec_and_find_symbol() always fall back.
+ *
+ * By default a symbol is found when an entry of that name is a function
+ * or an object, whether the binary defines it or imports it (an undefined
+ * entry), so a lookup also answers whether a binary uses a symbol. With
+ * EXEC_LOOKUP_DEFINED it is found only when the binary defines it, as
+ * any kind of symbol but a section or file entry: functions and objects,
+ * IFUNC and TLS symbols, and untyped ones such as _end. This is the rule
+ * ExecImage and the bulk scans use.
+ */
+#define EXEC_LOOKUP_SYMTAB    0x1
+#define EXEC_LOOKUP_DEFINED   0x2
+
 int find_symbol_in_executable(const char *filename, const char *symbol);
+int find_symbol_in_executable_ex(const char *filename, const char *symbol, int flags);
 int parse_exec_and_find_symbol(int fd, const char *symbol);
 
+/*
+ * Persistent symbol index cache. Once a cache directory is set, lookups
+ * that fall back to .symtab store a compact, mmap-able hash index of its
+ * names there and answer later queries on the same binary from it instead
+ * of scanning the table again (the dynamic symbols are looked up through
+ * the binary's own hash table either way). Entries are keyed by the
+ * binary's GNU build-id, or by (dev, inode, size, mtime) when it has none;
+ * an entry that no longer matches its binary is rebuilt by the next
+ * lookup. Index files are created with the caller's umask. A directory
+ * that cannot be written is still read: once a store fails with EACCES,
+ * EPERM or EROFS, misses just scan .symtab. NULL turns the cache off.
+ * Returns 1, or -1 if 'dir' is not a directory.
+ */
+int exec_lookup_set_cache_dir(const char *dir);
+
+/*
+ * Open-once executable handle for many queries against one binary. The
+ * file is mapped and its headers checked once; the first lookup builds a
+ * hash index over every symbol in .dynsym and .symtab that is defined, by
+ * the EXEC_LOOKUP_DEFINED rule, and later lookups are a hash probe. When
+ * a name occurs more than once, a global definition wins over a local one
+ * and the default symbol version over hidden ones; otherwise .dynsym
+ * comes first.
+ *
+ * Symbol metadata: 'type' and 'binding' are the ELF STT_ and STB_ values,
+ * 'section' the section index (or SHN_ABS, ...) and 'section_name' its
+ * name, NULL for special indexes. 'name' and 'section_name' point into
+ * the mapping and stay valid until exec_image_close().
+ *
+ * Lookups return 1 if found, -1 otherwise; the batch call fills out[i]
+ * and found[i] (if non-NULL) and returns the number found. A handle may
+ * be queried from several threads at once.
+ */
+typedef struct ExecImage ExecImage;
+
+typedef struct ExecSymbol {
+   const char *name;
+   uint64_t value;
+   uint64_t size;
+   int type;
+   int binding;
+   int section;
+   const char *section_name;
+   int dynamic;      /* from .dynsym */
+} ExecSymbol;
+
+ExecImage* exec_image_open(const char *filename);
+int exec_image_find_symbol(ExecImage *image, const char *symbol, ExecSymbol *out);
+int exec_image_find_symbols_batch(ExecImage *image, const char **symbols, int count,
+                                  ExecSymbol *out, int *found);
+void exec_image_close(ExecImage *image);
+
+/* ExecScanOptions flags */
+#define EXEC_SCAN_SYMTAB      EXEC_LOOKUP_SYMTAB  /* also consult .symtab */
+#define EXEC_SCAN_PREFETCH    0x10  /* start reading queued files ahead of the workers */
+
+/*
+ * Bulk symbol scan over many binaries. exec_scan_files() scans the given
+ * paths, exec_scan_tree() every regular file below 'root' (symbolic links
+ * are not followed). Files are handed to a pool of 'threads' workers
+ * (0: one per online CPU). At most 'max_inflight' files (0: four per
+ * worker) are queued, open or being scanned at a time, so that is also
+ * the bound on open descriptors and outstanding reads, plus the one
+ * directory exec_scan_tree() is reading at any depth; a value below
+ * 'threads' leaves workers idle. Files that are not 64-bit ELF are
+ * dropped after reading their header.
+ *
+ * With EXEC_SCAN_PREFETCH the walking thread opens each file as it queues
+ * it and asks the kernel to read ahead the parts a lookup touches, so the
+ * I/O overlaps with the workers' parsing.
+ *
+ * For every ELF file the callback gets the path and found[i] = 1 or 0 for
+ * each of the 'count' symbols, 1 if the file defines it by the
+ * EXEC_LOOKUP_DEFINED rule. Dynamic symbols are looked up through the
+ * binary's hash table; with EXEC_SCAN_SYMTAB all symbols are matched as
+ * by exec_image_find_symbol(). Callbacks never run concurrently but come
+ * from the worker threads, in no particular order; a non-zero return
+ * stops the scan. 'options' may be NULL for the defaults. Both functions
+ * return the number of files reported, -1 if the scan could not be
+ * started.
+ */
+typedef struct ExecScanOptions {
+   int threads;
+   int max_inflight;
+   int flags;
+} ExecScanOptions;
+
+typedef int (*ExecScanFunc)(const char *path, const int *found, int count, void *ctx);
+
+long exec_scan_files(const char **paths, size_t path_count, const char **symbols, int count,
+                     const ExecScanOptions *options, ExecScanFunc on_file, void *ctx);
+long exec_scan_tree(const char *root, const char **symbols, int count,
+                    const ExecScanOptions *options, ExecScanFunc on_file, void *ctx);
+
 #endif /* EXEC_LOOKUP_H */
@@ -22,17 +22,105 @@
 #ifndef _HASH_LOOKUP_H_
 #define _HASH_LOOKUP_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
+/* hash_table_create_ex() flags */
+#define HASH_TABLE_ARENA      0x1   /* intern keys in table-owned chunks */
+
+struct HashArena;
+struct HashImage;
+
+/*
+ * Key hash: 'len' bytes of 'data' mixed with 'seed'. The default is
+ * lookup_hash64(), seeded wyhash final version 4; tables get a fresh
+ * seed from lookup_hash_seed() unless one is set with hash_table_set_hash().
+ */
+typedef uint64_t (*HashFunc)(const void *data, size_t len, uint64_t seed);
+
+uint64_t lookup_hash64(const void *data, size_t len, uint64_t seed);
+uint64_t lookup_hash_seed(void);
+
+/*
+ * Open-addressing hash table with Robin Hood linear probing.
+ *
+ * Every slot caches the full 64-bit hash of its key, so probing compares
+ * hashes before strings and resizing never rehashes a key. Slots with a
+ * zero hash are empty. Removal uses backward-shift deletion,
+ * so there are no tombstones. When the load factor is exceeded the table
+ * doubles, and the previous generation ('old') is drained into the new
+ * arrays a few entries per write instead of all at once. 'size' counts
+ * every live entry, including those still waiting in 'old'. Capacity
+ * stops at 2^30 slots: creating a larger table returns NULL, and inserts
+ * into a full one fail.
+ *
+ * With HASH_TABLE_ARENA, keys are copied back to back into large chunks
+ * owned by the table instead of being strdup'ed one by one. Removing a
+ * key does not return its bytes; hash_table_free() releases whole chunks.
+ *
+ * A table returned by hash_table_open_mmap() has no slot arrays of its own:
+ * 'image' points at the mapped file and lookups probe it in place.
+ */
 typedef struct HashTable {
    char **keys;
    void **values;
+   uint64_t *hashes;
    int capacity;
    int size;
+   struct HashTable *old;
+   int migrate_pos;
+   int flags;
+   struct HashArena *arena;
+   HashFunc hash_func;
+   uint64_t seed;
+   const struct HashImage *image;
+   size_t image_size;
 } HashTable;
 
+/* Original shift-add string hash, kept for existing callers. */
+unsigned int hash_function(const char *str);
+
 HashTable* hash_table_create(int capacity);
+HashTable* hash_table_create_ex(int capacity, int flags);
+int hash_table_set_hash(HashTable *table, HashFunc func, uint64_t seed);
 int hash_lookup(HashTable *table, const char *key, void **value);
 int hash_insert(HashTable *table, const char *key, void *value);
 int hash_remove(HashTable *table, const char *key);
+int hash_lookup_many(HashTable *table, const char **keys, int n,
+                     void **values_out, int *found_out);
+int hash_insert_many(HashTable *table, const char **keys, void **values, int n);
+int hash_table_save(HashTable *table, const char *path);
+HashTable* hash_table_open_mmap(const char *path);
 void hash_table_free(HashTable *table);
 
+/*
+ * Group-probing hash table (Swiss-table layout).
+ *
+ * Every slot has a control byte in 'ctrl' holding 7 bits of its hash, or
+ * one of the EMPTY/DELETED markers. Slots are probed 16 at a time: one
+ * SIMD compare over a group of control bytes yields the candidate slots,
+ * and only those are compared with strcmp. A miss usually costs a single
+ * group compare that finds an EMPTY byte.
+ *
+ * Keys are always hashed with lookup_hash64() under a per-table seed; the
+ * full hash is kept in 'hashes' so a resize never hashes a key again.
+ * Capacity is bounded at 2^30 slots, as for HashTable.
+ */
+typedef struct GroupHashTable {
+   unsigned char *ctrl;
+   char **keys;
+   void **values;
+   uint64_t *hashes;
+   int capacity;
+   int size;
+   int growth_left;
+   uint64_t seed;
+} GroupHashTable;
+
+GroupHashTable* group_hash_table_create(int capacity);
+int group_hash_lookup(GroupHashTable *table, const char *key, void **value);
+int group_hash_insert(GroupHashTable *table, const char *key, void *value);
+int group_hash_remove(GroupHashTable *table, const char *key);
+void group_hash_table_free(GroupHashTable *table);
+
 #endif /* _HASH_LOOKUP_H_ */
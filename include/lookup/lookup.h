@@ -24,7 +24,11 @@
 
 #include <lookup/array_lookup.h>
 #include <lookup/hash_lookup.h>
+#include <lookup/concurrent_hash_lookup.h>
+#include <lookup/perfect_hash_lookup.h>
 #include <lookup/string_lookup.h>
+#include <lookup/radix_tree_lookup.h>
+#include <lookup/pattern_lookup.h>
 #include <lookup/symbol_lookup.h>
 #include <lookup/exec_lookup.h>
 
@@ -0,0 +1,61 @@
+/*
+ * lookup/pattern_lookup.h - Multi-pattern buffer and file scanning
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PATTERN_LOOKUP_H_
+#define _PATTERN_LOOKUP_H_
+
+#include <stddef.h>
+
+/*
+ * Compiled matcher that finds every occurrence of any of a set of literal
+ * patterns in one pass over a buffer.
+ *
+ * Small sets (up to 64 patterns) use a Teddy-style prefilter: patterns are
+ * spread over 8 buckets, and the low and high nibbles of the first one to
+ * three bytes at each position are looked up with SSSE3 shuffles, giving
+ * for 16 positions at once the buckets that could start there. Only those
+ * buckets' patterns are compared. Larger sets run an Aho-Corasick
+ * automaton, as a dense byte-class DFA when it fits in a few megabytes and
+ * with sparse edges and failure links otherwise; while the automaton is
+ * at its root it skips ahead with SIMD to the next byte that can start a
+ * pattern. The SSSE3 kernels are chosen at run time, when the matcher is
+ * built, if the CPU supports them; otherwise the same nibble tables are
+ * walked one byte at a time.
+ *
+ * Every occurrence, including overlapping ones, is passed to the callback
+ * once as (pattern index, offset of its first byte). Matches are reported
+ * as the scan advances, but not strictly by offset. A non-zero return
+ * from the callback stops the scan. Empty patterns never match. The scan
+ * functions return the number of matches reported, -1 if the file cannot
+ * be mapped.
+ */
+typedef struct PatternMatcher PatternMatcher;
+
+typedef int (*PatternMatchFunc)(int pattern, size_t offset, void *ctx);
+
+PatternMatcher* pattern_matcher_build(const char *arr[], int size);
+long pattern_matcher_scan(const PatternMatcher *matcher, const void *buf, size_t len,
+                          PatternMatchFunc on_match, void *ctx);
+long pattern_matcher_scan_file(const PatternMatcher *matcher, const char *path,
+                               PatternMatchFunc on_match, void *ctx);
+void pattern_matcher_free(PatternMatcher *matcher);
+
+#endif /* _PATTERN_LOOKUP_H_ */
@@ -0,0 +1,59 @@
+/*
+ * lookup/perfect_hash_lookup.h - Frozen perfect hash tables
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PERFECT_HASH_LOOKUP_H_
+#define _PERFECT_HASH_LOOKUP_H_
+
+#include <lookup/hash_lookup.h>
+
+typedef struct PerfectHashEntry {
+   uint64_t hash;
+   uint32_t key_offset;
+   uint32_t key_length;
+   void *value;
+} PerfectHashEntry;
+
+/*
+ * Read-only snapshot of a HashTable behind a perfect hash
+ * (CHD-style hash and displace).
+ *
+ * A key's hash picks a bucket, the bucket's displacement picks exactly one
+ * of the 'slots' entries, and the entry's cached hash and key bytes are
+ * compared. There is no probing. 'slots' is a few percent above 'count'
+ * so construction stays fast on large key sets; unused entries have a
+ * zero hash. The displacement table, the entries and the key bytes all
+ * live in one allocation with the header.
+ */
+typedef struct PerfectHashTable {
+   uint64_t seed;
+   uint32_t count;
+   uint32_t slots;
+   uint32_t buckets;
+   const uint32_t *displacements;
+   const PerfectHashEntry *entries;
+   const char *key_data;
+} PerfectHashTable;
+
+PerfectHashTable* hash_table_freeze(HashTable *table);
+int perfect_hash_lookup(const PerfectHashTable *table, const char *key, void **value);
+void perfect_hash_table_free(PerfectHashTable *table);
+
+#endif /* _PERFECT_HASH_LOOKUP_H_ */
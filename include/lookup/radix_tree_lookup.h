@@ -0,0 +1,59 @@
+/*
+ * lookup/radix_tree_lookup.h - Adaptive radix tree string index
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _RADIX_TREE_LOOKUP_H_
+#define _RADIX_TREE_LOOKUP_H_
+
+struct RadixArena;
+
+/*
+ * Static adaptive radix tree (ART) over a set of strings.
+ *
+ * Inner nodes come in four sizes, holding up to 4, 16, 48 or 256 children,
+ * picked by the branching factor at that point; Node16 keys are searched
+ * with one SIMD compare. Runs of bytes shared by a whole subtree are kept
+ * on the node as a compressed path, and a single remaining key becomes a
+ * leaf directly. The string terminator acts as a key byte, so a key that
+ * is a prefix of another gets its own leaf.
+ *
+ * The tree is bulk-loaded from a sorted copy of the input and never
+ * modified. Nodes, leaves and key bytes live in table-owned arena chunks.
+ * Lookups return the index of the key in the original array; of equal
+ * strings the first one wins. Prefix enumeration visits keys in strcmp
+ * order, stops when the callback returns non-zero and returns the number
+ * of keys visited.
+ */
+typedef struct RadixTree {
+   void *root;
+   struct RadixArena *arena;
+   int size;
+} RadixTree;
+
+typedef int (*RadixTreeVisit)(const char *key, int index, void *ctx);
+
+RadixTree* radix_tree_build(const char *arr[], int size);
+int radix_tree_lookup(const RadixTree *tree, const char *key);
+int radix_tree_longest_prefix(const RadixTree *tree, const char *key);
+int radix_tree_prefix_each(const RadixTree *tree, const char *prefix, RadixTreeVisit visit,
+                           void *ctx);
+void radix_tree_free(RadixTree *tree);
+
+#endif /* _RADIX_TREE_LOOKUP_H_ */
@@ -22,8 +22,87 @@
 #ifndef _STRING_LOOKUP_H_
 #define _STRING_LOOKUP_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 int string_lookup(const char *arr[], int size, const char *target);
 int case_insensitive_string_lookup(const char *arr[], int size, const char *target);
 int binary_search_string(const char *arr[], int size, const char *target);
 
+/* Batched binary_search_string(); see binary_search_int_batch(). */
+void binary_search_string_batch(const char *arr[], int size, const char *queries[], int count,
+                                int *out);
+void binary_search_string_batch_sorted(const char *arr[], int size, const char *queries[],
+                                       int count, int *out);
+
+/*
+ * Build-once string set for repeated string_lookup() calls against the
+ * same list. The strings are copied back to back, and their lengths and
+ * first 8 bytes (zero padded) are kept in separate dense arrays. A lookup
+ * compares the target's length and prefix against four entries at a time
+ * with SIMD, and only touches the string bytes of the few entries that
+ * pass both. string_set_lookup() returns the index in the original array
+ * of the first equal string, or -1.
+ */
+typedef struct StringSet {
+   char *data;
+   uint32_t *offsets;
+   uint32_t *lengths;
+   uint64_t *prefixes;
+   int size;
+} StringSet;
+
+StringSet* string_set_build(const char *arr[], int size);
+int string_set_lookup(const StringSet *set, const char *target);
+void string_set_free(StringSet *set);
+
+/*
+ * Build-once index for case_insensitive_string_lookup(). Every string is
+ * case-folded once at build time and stored in a hash table keyed by a
+ * hash of its folded form. A lookup folds the target (16 bytes at a time
+ * with SIMD while the input is ASCII, per byte with tolower() otherwise),
+ * hashes it and probes, so it costs about as much as a case-sensitive
+ * hash lookup. Non-ASCII bytes fold according to the locale at build
+ * time, since the strings are folded then; rebuild the index after
+ * setlocale() to keep matching strcasecmp(). Returns the index in the
+ * original array of the first matching string, or -1.
+ */
+struct CaseFoldSlot;
+
+typedef struct CaseInsensitiveIndex {
+   char *data;
+   uint32_t *offsets;
+   struct CaseFoldSlot *slots;
+   uint32_t mask;
+   uint64_t seed;
+   int size;
+} CaseInsensitiveIndex;
+
+CaseInsensitiveIndex* case_insensitive_index_build(const char *arr[], int size);
+int case_insensitive_index_lookup(const CaseInsensitiveIndex *index, const char *target);
+void case_insensitive_index_free(CaseInsensitiveIndex *index);
+
+/*
+ * Build-once index over a strcmp-sorted array, for binary_search_string()
+ * on large dictionaries. Each entry keeps its first 8 bytes inline as a
+ * big-endian integer, so the bisection is integer compares over one dense
+ * array. The strings themselves are front-coded in blocks of 16: a block
+ * starts with a full string and every following entry stores only the
+ * length it shares with its predecessor and the remaining suffix. String
+ * bytes are read only when several entries share the target's 8-byte
+ * prefix; the index then bisects the block heads and walks one block
+ * without decoding it. Returns the position of the first equal string,
+ * or -1.
+ */
+typedef struct SortedStringIndex {
+   uint64_t *prefixes;
+   size_t *block_offsets;
+   unsigned char *blob;
+   int size;
+} SortedStringIndex;
+
+SortedStringIndex* sorted_string_index_build(const char *arr[], int size);
+int sorted_string_index_find(const SortedStringIndex *index, const char *target);
+void sorted_string_index_free(SortedStringIndex *index);
+
 #endif /* STRING_LOOKUP_H */
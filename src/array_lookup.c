@@ -20,37 +20,475 @@
  */
 
 #include <lookup/array_lookup.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define ARRAY_PREFETCH(addr)  __builtin_prefetch(addr)
+#define ARRAY_FFS(x)          __builtin_ffs(x)
+#else
+#define ARRAY_PREFETCH(addr)  ((void)(addr))
+#define ARRAY_FFS(x)          __array_ffs(x)
+
+/* One plus the index of the lowest set bit, 0 for 0. */
+static int __array_ffs(int x)
+{
+   unsigned int bits = (unsigned int)x;
+   if (!bits) {
+       return 0;
+   }
+   int bit = 1;
+   while (!(bits & 1)) {
+       bits >>= 1;
+       bit++;
+   }
+   return bit;
+}
+#endif
+
+#define ARRAY_CACHE_LINE      64
+#define EYTZINGER_MAX_SIZE    ((1 << 30) - 1)   /* keeps 2k + 1 within an int */
+#define ARRAY_SEARCH_BATCH    16    /* queries descending in lockstep */
+#define ARRAY_HUGE_PAGE       (2 * 1024 * 1024)
+#define BTREE_NODE            16    /* keys per S+ tree node */
+#define ARRAY_POOL_MAX        64    /* parallel scan worker threads, at most */
+#define ARRAY_PAR_BLOCK       16384 /* elements scanned between cancellation checks */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define ARRAY_X86_DISPATCH    1
+#endif
+
+/*
+ * Linear scan kernels.
+ *
+ * Scans are generated per element kind rather than per public type: int
+ * and uint32_t share the 32-bit integer kernels, int64_t and uint64_t the
+ * 64-bit ones, and float and double get IEEE compares (so -0.0 matches
+ * 0.0 and NaN matches nothing). Each kind calls through a kernel pointer
+ * that starts out at the scalar loop and is upgraded once at load time to
+ * the widest vector unit the CPU reports (AVX-512F, AVX2, then SSE4.2).
+ * A vector kernel compares a whole register of elements against the
+ * splatted target, turns the result into a bitmask and returns the index
+ * of its lowest set bit. Elements past the last full register go through
+ * the scalar loop.
+ */
+#define ARRAY_SCAN_SCALAR(kind, T)                                             \
+static size_t __##kind##_scan_scalar(const T *arr, size_t size, T target)      \
+{                                                                              \
+   for (size_t i = 0; i < size; i++) {                                         \
+       if (arr[i] == target) {                                                 \
+           return i;  /* Found */                                              \
+       }                                                                       \
+   }                                                                           \
+   return ARRAY_NPOS;  /* Not found */                                         \
+}
+
+/*
+ * SPLAT(target) declares 'needle'; MATCH(p) yields the bitmask of lanes
+ * at 'p' equal to it.
+ */
+#define ARRAY_SCAN_VECTOR(kind, T, isa, attr, lanes, SPLAT, MATCH)             \
+__attribute__((target(attr)))                                                  \
+static size_t __##kind##_scan_##isa(const T *arr, size_t size, T target)       \
+{                                                                              \
+   SPLAT(target);                                                              \
+   size_t i = 0;                                                               \
+   for (; i + lanes <= size; i += lanes) {                                     \
+       unsigned int mask = MATCH(arr + i);                                     \
+       if (mask) {                                                             \
+           return i + __builtin_ctz(mask);                                     \
+       }                                                                       \
+   }                                                                           \
+   size_t rest = __##kind##_scan_scalar(arr + i, size - i, target);            \
+   return rest == ARRAY_NPOS ? ARRAY_NPOS : i + rest;                          \
+}
+
+/* Lets 'const T *' spell void *const * for the pointer kernels. */
+typedef void *array_ptr_t;
+
+ARRAY_SCAN_SCALAR(u32, uint32_t)
+ARRAY_SCAN_SCALAR(u64, uint64_t)
+ARRAY_SCAN_SCALAR(f32, float)
+ARRAY_SCAN_SCALAR(f64, double)
+ARRAY_SCAN_SCALAR(pointer, array_ptr_t)
+
+#ifdef ARRAY_X86_DISPATCH
+#define SPLAT_U32_128(t)   __m128i needle = _mm_set1_epi32((int)(t))
+#define SPLAT_U32_256(t)   __m256i needle = _mm256_set1_epi32((int)(t))
+#define SPLAT_U32_512(t)   __m512i needle = _mm512_set1_epi32((int)(t))
+#define SPLAT_U64_128(t)   __m128i needle = _mm_set1_epi64x((long long)(t))
+#define SPLAT_U64_256(t)   __m256i needle = _mm256_set1_epi64x((long long)(t))
+#define SPLAT_U64_512(t)   __m512i needle = _mm512_set1_epi64((long long)(t))
+#define SPLAT_F32_128(t)   __m128 needle = _mm_set1_ps(t)
+#define SPLAT_F32_256(t)   __m256 needle = _mm256_set1_ps(t)
+#define SPLAT_F32_512(t)   __m512 needle = _mm512_set1_ps(t)
+#define SPLAT_F64_128(t)   __m128d needle = _mm_set1_pd(t)
+#define SPLAT_F64_256(t)   __m256d needle = _mm256_set1_pd(t)
+#define SPLAT_F64_512(t)   __m512d needle = _mm512_set1_pd(t)
+#define SPLAT_PTR_128(t)   SPLAT_U64_128((uintptr_t)(t))
+#define SPLAT_PTR_256(t)   SPLAT_U64_256((uintptr_t)(t))
+#define SPLAT_PTR_512(t)   SPLAT_U64_512((uintptr_t)(t))
+
+#define MATCH_U32_128(p)   _mm_movemask_ps(_mm_castsi128_ps(                                 \
+                               _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(p)), needle)))
+#define MATCH_U32_256(p)   _mm256_movemask_ps(_mm256_castsi256_ps(                           \
+                               _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(p)), needle)))
+#define MATCH_U32_512(p)   _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(p), needle)
+#define MATCH_U64_128(p)   _mm_movemask_pd(_mm_castsi128_pd(                                 \
+                               _mm_cmpeq_epi64(_mm_loadu_si128((const __m128i *)(p)), needle)))
+#define MATCH_U64_256(p)   _mm256_movemask_pd(_mm256_castsi256_pd(                           \
+                               _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *)(p)), needle)))
+#define MATCH_U64_512(p)   _mm512_cmpeq_epi64_mask(_mm512_loadu_si512(p), needle)
+#define MATCH_F32_128(p)   _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(p), needle))
+#define MATCH_F32_256(p)   _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(p), needle, _CMP_EQ_OQ))
+#define MATCH_F32_512(p)   _mm512_cmp_ps_mask(_mm512_loadu_ps(p), needle, _CMP_EQ_OQ)
+#define MATCH_F64_128(p)   _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(p), needle))
+#define MATCH_F64_256(p)   _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p), needle, _CMP_EQ_OQ))
+#define MATCH_F64_512(p)   _mm512_cmp_pd_mask(_mm512_loadu_pd(p), needle, _CMP_EQ_OQ)
+
+#define ARRAY_SCAN_X86(kind, T, K, bytes)                                                  \
+   ARRAY_SCAN_VECTOR(kind, T, sse42, "sse4.2", 16 / (bytes), SPLAT_##K##_128, MATCH_##K##_128) \
+   ARRAY_SCAN_VECTOR(kind, T, avx2, "avx2", 32 / (bytes), SPLAT_##K##_256, MATCH_##K##_256)    \
+   ARRAY_SCAN_VECTOR(kind, T, avx512, "avx512f", 64 / (bytes), SPLAT_##K##_512, MATCH_##K##_512)
+
+ARRAY_SCAN_X86(u32, uint32_t, U32, 4)
+ARRAY_SCAN_X86(u64, uint64_t, U64, 8)
+ARRAY_SCAN_X86(f32, float, F32, 4)
+ARRAY_SCAN_X86(f64, double, F64, 8)
+#if UINTPTR_MAX == UINT64_MAX
+#define MATCH_PTR_128      MATCH_U64_128
+#define MATCH_PTR_256      MATCH_U64_256
+#define MATCH_PTR_512      MATCH_U64_512
+ARRAY_SCAN_X86(pointer, array_ptr_t, PTR, 8)
+#endif
+#endif /* ARRAY_X86_DISPATCH */
+
+static size_t (*u32_scan)(const uint32_t *, size_t, uint32_t) = __u32_scan_scalar;
+static size_t (*u64_scan)(const uint64_t *, size_t, uint64_t) = __u64_scan_scalar;
+static size_t (*f32_scan)(const float *, size_t, float) = __f32_scan_scalar;
+static size_t (*f64_scan)(const double *, size_t, double) = __f64_scan_scalar;
+static size_t (*pointer_scan)(void *const *, size_t, void *) = __pointer_scan_scalar;
+
+#ifdef ARRAY_X86_DISPATCH
+#define ARRAY_SCAN_SELECT(kind, isa)   kind##_scan = __##kind##_scan_##isa
+
+__attribute__((constructor))
+static void __array_dispatch_init(void)
+{
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx512f")) {
+       ARRAY_SCAN_SELECT(u32, avx512);
+       ARRAY_SCAN_SELECT(u64, avx512);
+       ARRAY_SCAN_SELECT(f32, avx512);
+       ARRAY_SCAN_SELECT(f64, avx512);
+   } else if (__builtin_cpu_supports("avx2")) {
+       ARRAY_SCAN_SELECT(u32, avx2);
+       ARRAY_SCAN_SELECT(u64, avx2);
+       ARRAY_SCAN_SELECT(f32, avx2);
+       ARRAY_SCAN_SELECT(f64, avx2);
+   } else if (__builtin_cpu_supports("sse4.2")) {
+       ARRAY_SCAN_SELECT(u32, sse42);
+       ARRAY_SCAN_SELECT(u64, sse42);
+       ARRAY_SCAN_SELECT(f32, sse42);
+       ARRAY_SCAN_SELECT(f64, sse42);
+   }
+#if UINTPTR_MAX == UINT64_MAX
+   if (__builtin_cpu_supports("avx512f")) {
+       ARRAY_SCAN_SELECT(pointer, avx512);
+   } else if (__builtin_cpu_supports("avx2")) {
+       ARRAY_SCAN_SELECT(pointer, avx2);
+   } else if (__builtin_cpu_supports("sse4.2")) {
+       ARRAY_SCAN_SELECT(pointer, sse42);
+   }
+#endif
+}
+#endif /* ARRAY_X86_DISPATCH */
 
 /* Array lookup functions */
 int int_array_lookup(int *arr, int size, int target)
 {
-   for (int i = 0; i < size; i++) {
-       if (arr[i] == target) {
-           return i;  // Found
+   size_t idx = size > 0 ? u32_scan((const uint32_t *)arr, size, target) : ARRAY_NPOS;
+   return idx == ARRAY_NPOS ? -1 : (int)idx;
+}
+
+float float_array_lookup(float *arr, int size, float target)
+{
+   size_t idx = size > 0 ? f32_scan(arr, size, target) : ARRAY_NPOS;
+   return idx == ARRAY_NPOS ? -1 : (float)idx;
+}
+
+void* pointer_array_lookup(void **arr, int size, void *target)
+{
+   return size > 0 && pointer_scan(arr, size, target) != ARRAY_NPOS ? target : NULL;
+}
+
+/*
+ * Typed size_t searches. lower_bound and upper_bound are branchless
+ * bisections like binary_search_int_branchless(); binary_search and
+ * equal_range are built on them.
+ */
+#define ARRAY_TYPED_SEARCH(sfx, T, SCAN, K)                                    \
+size_t array_lookup_##sfx(const T *arr, size_t size, T target)                \
+{                                                                              \
+   return SCAN((const K *)arr, size, target);                                  \
+}                                                                              \
+                                                                               \
+size_t array_lower_bound_##sfx(const T *arr, size_t size, T target)           \
+{                                                                              \
+   if (size == 0) {                                                            \
+       return 0;                                                               \
+   }                                                                           \
+   const T *base = arr;                                                        \
+   size_t n = size;                                                            \
+   while (n > 1) {                                                             \
+       size_t half = n / 2;                                                    \
+       ARRAY_PREFETCH(base + half / 2);                                        \
+       ARRAY_PREFETCH(base + half + half / 2);                                 \
+       base = base[half] < target ? base + half : base;                        \
+       n -= half;                                                              \
+   }                                                                           \
+   return (size_t)(base - arr) + (*base < target);                             \
+}                                                                              \
+                                                                               \
+size_t array_upper_bound_##sfx(const T *arr, size_t size, T target)           \
+{                                                                              \
+   if (size == 0) {                                                            \
+       return 0;                                                               \
+   }                                                                           \
+   const T *base = arr;                                                        \
+   size_t n = size;                                                            \
+   while (n > 1) {                                                             \
+       size_t half = n / 2;                                                    \
+       ARRAY_PREFETCH(base + half / 2);                                        \
+       ARRAY_PREFETCH(base + half + half / 2);                                 \
+       base = !(target < base[half]) ? base + half : base;                     \
+       n -= half;                                                              \
+   }                                                                           \
+   return (size_t)(base - arr) + !(target < *base);                            \
+}                                                                              \
+                                                                               \
+size_t array_binary_search_##sfx(const T *arr, size_t size, T target)         \
+{                                                                              \
+   size_t idx = array_lower_bound_##sfx(arr, size, target);                    \
+   return idx < size && arr[idx] == target ? idx : ARRAY_NPOS;                 \
+}                                                                              \
+                                                                               \
+size_t array_equal_range_##sfx(const T *arr, size_t size, T target, size_t *first) \
+{                                                                              \
+   if (!(target == target)) {                                                  \
+       *first = size;  /* NaN equals nothing */                                \
+       return 0;                                                               \
+   }                                                                           \
+   *first = array_lower_bound_##sfx(arr, size, target);                        \
+   if (*first == size || !(arr[*first] == target)) {                           \
+       return 0;                                                               \
+   }                                                                           \
+   size_t last = *first + array_upper_bound_##sfx(arr + *first, size - *first, target); \
+   return last - *first;                                                       \
+}
+
+ARRAY_TYPED_SEARCH(int, int, u32_scan, uint32_t)
+ARRAY_TYPED_SEARCH(uint32, uint32_t, u32_scan, uint32_t)
+ARRAY_TYPED_SEARCH(int64, int64_t, u64_scan, uint64_t)
+ARRAY_TYPED_SEARCH(uint64, uint64_t, u64_scan, uint64_t)
+ARRAY_TYPED_SEARCH(float, float, f32_scan, float)
+ARRAY_TYPED_SEARCH(double, double, f64_scan, double)
+
+/*
+ * Parallel scans.
+ *
+ * A job splits the array into chunks that participants claim in
+ * ascending order from a shared counter, each scanning its chunk with the
+ * dispatched kernel in blocks. A match lowers the job's 'found' index with
+ * a CAS; everyone skips blocks at or beyond it. Every block before the
+ * final answer has therefore been scanned, and the result is the first
+ * match, as with a sequential scan.
+ *
+ * Workers come from a process-wide pool that grows on demand and is never
+ * torn down. The calling thread always takes part. While one job is
+ * running, a concurrent caller scans on its own rather than waiting.
+ */
+struct ArrayScanJob {
+   size_t (*scan)(const void *arr, size_t size, const void *target);
+   const char *base;
+   size_t elem_size;
+   const void *target;
+   size_t size;
+   size_t chunk;
+   atomic_size_t next;
+   atomic_size_t found;
+   int wanted;    /* workers still allowed to join */
+   int active;    /* workers inside __par_run() */
+};
+
+static struct {
+   pthread_mutex_t lock;
+   pthread_cond_t wake;
+   pthread_cond_t idle;
+   struct ArrayScanJob *job;
+   int workers;
+} array_pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+                 PTHREAD_COND_INITIALIZER, NULL, 0 };
+
+static void __par_run(struct ArrayScanJob *job)
+{
+   for (;;) {
+       size_t start = atomic_fetch_add(&job->next, job->chunk);
+       if (start >= job->size) {
+           return;
+       }
+       size_t end = job->size - start > job->chunk ? start + job->chunk : job->size;
+       for (size_t b = start; b < end; b += ARRAY_PAR_BLOCK) {
+           if (b >= atomic_load_explicit(&job->found, memory_order_relaxed)) {
+               return;  // later chunks only hold larger indexes
+           }
+           size_t len = end - b > ARRAY_PAR_BLOCK ? ARRAY_PAR_BLOCK : end - b;
+           size_t idx = job->scan(job->base + b * job->elem_size, len, job->target);
+           if (idx != ARRAY_NPOS) {
+               idx += b;
+               size_t cur = atomic_load(&job->found);
+               while (idx < cur && !atomic_compare_exchange_weak(&job->found, &cur, idx)) {
+               }
+               return;
+           }
        }
    }
-   return -1;  // Not found
 }
 
-float float_array_lookup(float *arr, int size, float target)
+static void* __pool_worker(void *arg)
 {
-   for (int i = 0; i < size; i++) {
-       if (arr[i] == target) {
-           return i;  // Found
+   (void)arg;
+   pthread_mutex_lock(&array_pool.lock);
+   for (;;) {
+       while (!array_pool.job || array_pool.job->wanted == 0) {
+           pthread_cond_wait(&array_pool.wake, &array_pool.lock);
+       }
+       struct ArrayScanJob *job = array_pool.job;
+       job->wanted--;
+       job->active++;
+       pthread_mutex_unlock(&array_pool.lock);
+       __par_run(job);
+       pthread_mutex_lock(&array_pool.lock);
+       if (--job->active == 0) {
+           pthread_cond_broadcast(&array_pool.idle);
        }
    }
-   return -1;  // Not found
+   return NULL;
 }
 
-void* pointer_array_lookup(void **arr, int size, void *target)
+/* Called with the pool lock held. Returns the number of workers available. */
+static int __pool_reserve(int count)
 {
-   for (int i = 0; i < size; i++) {
-       if (arr[i] == target) {
-           return arr[i];  // Found
+   count = count > ARRAY_POOL_MAX ? ARRAY_POOL_MAX : count;
+   while (array_pool.workers < count) {
+       pthread_attr_t attr;
+       pthread_t thread;
+       pthread_attr_init(&attr);
+       pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+       int err = pthread_create(&thread, &attr, __pool_worker, NULL);
+       pthread_attr_destroy(&attr);
+       if (err) {
+           break;
        }
+       array_pool.workers++;
+   }
+   return array_pool.workers < count ? array_pool.workers : count;
+}
+
+static size_t __par_scan(struct ArrayScanJob *job, int threads, size_t min_chunk)
+{
+   if (min_chunk == 0) {
+       min_chunk = ARRAY_PAR_MIN_CHUNK;
+   }
+   if (threads <= 0) {
+       long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+       threads = cpus > 0 ? (int)cpus : 1;
+   }
+   size_t chunks = job->size / min_chunk;
+   if ((size_t)threads > chunks) {
+       threads = chunks > 0 ? (int)chunks : 1;
+   }
+   if (threads == 1) {
+       return job->scan(job->base, job->size, job->target);
    }
-   return NULL;  // Not found
+
+   /* A few chunks per participant keeps them busy until the end. */
+   job->chunk = job->size / ((size_t)threads * 4);
+   job->chunk = job->chunk < min_chunk ? min_chunk : job->chunk;
+   atomic_init(&job->next, 0);
+   atomic_init(&job->found, ARRAY_NPOS);
+   job->active = 0;
+
+   pthread_mutex_lock(&array_pool.lock);
+   if (array_pool.job) {
+       pthread_mutex_unlock(&array_pool.lock);
+       return job->scan(job->base, job->size, job->target);
+   }
+   job->wanted = __pool_reserve(threads - 1);
+   array_pool.job = job;
+   pthread_cond_broadcast(&array_pool.wake);
+   pthread_mutex_unlock(&array_pool.lock);
+
+   __par_run(job);
+
+   pthread_mutex_lock(&array_pool.lock);
+   array_pool.job = NULL;
+   while (job->active > 0) {
+       pthread_cond_wait(&array_pool.idle, &array_pool.lock);
+   }
+   pthread_mutex_unlock(&array_pool.lock);
+   return atomic_load(&job->found);
+}
+
+static size_t __u32_par_scan(const void *arr, size_t size, const void *target)
+{
+   return u32_scan(arr, size, *(const uint32_t *)target);
+}
+
+static size_t __f32_par_scan(const void *arr, size_t size, const void *target)
+{
+   return f32_scan(arr, size, *(const float *)target);
+}
+
+static size_t __pointer_par_scan(const void *arr, size_t size, const void *target)
+{
+   return pointer_scan(arr, size, *(void *const *)target);
+}
+
+size_t int_array_lookup_par(const int *arr, size_t size, int target, int threads,
+                            size_t min_chunk)
+{
+   uint32_t bits = (uint32_t)target;
+   struct ArrayScanJob job = { .scan = __u32_par_scan, .base = (const char *)arr,
+                               .elem_size = sizeof(int), .target = &bits, .size = size };
+   return __par_scan(&job, threads, min_chunk);
+}
+
+size_t float_array_lookup_par(const float *arr, size_t size, float target, int threads,
+                              size_t min_chunk)
+{
+   struct ArrayScanJob job = { .scan = __f32_par_scan, .base = (const char *)arr,
+                               .elem_size = sizeof(float), .target = &target, .size = size };
+   return __par_scan(&job, threads, min_chunk);
+}
+
+void* pointer_array_lookup_par(void *const *arr, size_t size, void *target, int threads,
+                               size_t min_chunk)
+{
+   struct ArrayScanJob job = { .scan = __pointer_par_scan, .base = (const char *)arr,
+                               .elem_size = sizeof(void *), .target = &target, .size = size };
+   return __par_scan(&job, threads, min_chunk) != ARRAY_NPOS ? target : NULL;
 }
 
 /* Binary search functions */
@@ -87,3 +525,689 @@ float binary_search_float(float *arr, int size, float target)
    }
    return -1;  // Not found
 }
+
+/*
+ * Branchless lower bound: halve the window with a conditional move, so
+ * the loop runs exactly ceil(log2(size)) times whatever the data.
+ */
+int binary_search_int_branchless(int *arr, int size, int target)
+{
+   if (size <= 0) {
+       return -1;
+   }
+   const int *base = arr;
+   int n = size;
+   while (n > 1) {
+       int half = n / 2;
+       ARRAY_PREFETCH(base + half / 2);
+       ARRAY_PREFETCH(base + half + half / 2);
+       base = base[half] < target ? base + half : base;
+       n -= half;
+   }
+   int idx = (int)(base - arr) + (*base < target);
+   return idx < size && arr[idx] == target ? idx : -1;
+}
+
+int binary_search_float_branchless(float *arr, int size, float target)
+{
+   if (size <= 0) {
+       return -1;
+   }
+   const float *base = arr;
+   int n = size;
+   while (n > 1) {
+       int half = n / 2;
+       ARRAY_PREFETCH(base + half / 2);
+       ARRAY_PREFETCH(base + half + half / 2);
+       base = base[half] < target ? base + half : base;
+       n -= half;
+   }
+   int idx = (int)(base - arr) + (*base < target);
+   return idx < size && arr[idx] == target ? idx : -1;
+}
+
+/*
+ * Interleaved batch search. All queries in a group run the same
+ * branchless halving schedule, so they advance one level at a time
+ * together and the loads of different queries are independent.
+ */
+void binary_search_int_batch(int *arr, int size, const int *queries, int count, int *out)
+{
+   const int *base[ARRAY_SEARCH_BATCH];
+   for (int start = 0; start < count; start += ARRAY_SEARCH_BATCH) {
+       int group = count - start < ARRAY_SEARCH_BATCH ? count - start : ARRAY_SEARCH_BATCH;
+       const int *q = queries + start;
+       if (size <= 0) {
+           for (int g = 0; g < group; g++) {
+               out[start + g] = -1;
+           }
+           continue;
+       }
+       for (int g = 0; g < group; g++) {
+           base[g] = arr;
+       }
+       int n = size;
+       while (n > 1) {
+           int half = n / 2;
+           n -= half;
+           for (int g = 0; g < group; g++) {
+               base[g] = base[g][half] < q[g] ? base[g] + half : base[g];
+               ARRAY_PREFETCH(base[g] + n / 2);
+           }
+       }
+       for (int g = 0; g < group; g++) {
+           int idx = (int)(base[g] - arr) + (*base[g] < q[g]);
+           out[start + g] = idx < size && arr[idx] == q[g] ? idx : -1;
+       }
+   }
+}
+
+void binary_search_float_batch(float *arr, int size, const float *queries, int count, int *out)
+{
+   const float *base[ARRAY_SEARCH_BATCH];
+   for (int start = 0; start < count; start += ARRAY_SEARCH_BATCH) {
+       int group = count - start < ARRAY_SEARCH_BATCH ? count - start : ARRAY_SEARCH_BATCH;
+       const float *q = queries + start;
+       if (size <= 0) {
+           for (int g = 0; g < group; g++) {
+               out[start + g] = -1;
+           }
+           continue;
+       }
+       for (int g = 0; g < group; g++) {
+           base[g] = arr;
+       }
+       int n = size;
+       while (n > 1) {
+           int half = n / 2;
+           n -= half;
+           for (int g = 0; g < group; g++) {
+               base[g] = base[g][half] < q[g] ? base[g] + half : base[g];
+               ARRAY_PREFETCH(base[g] + n / 2);
+           }
+       }
+       for (int g = 0; g < group; g++) {
+           int idx = (int)(base[g] - arr) + (*base[g] < q[g]);
+           out[start + g] = idx < size && arr[idx] == q[g] ? idx : -1;
+       }
+   }
+}
+
+/*
+ * Sorted-query mode. Answers are monotone in the query value, so each
+ * search gallops forward from the previous answer instead of starting
+ * over: O(m log(n / m)) for m queries spread over n elements.
+ */
+struct IntQuery {
+   int value;
+   int index;
+};
+
+struct FloatQuery {
+   float value;
+   int index;
+};
+
+static int __int_query_cmp(const void *a, const void *b)
+{
+   int x = ((const struct IntQuery *)a)->value, y = ((const struct IntQuery *)b)->value;
+   return (x > y) - (x < y);
+}
+
+static int __float_query_cmp(const void *a, const void *b)
+{
+   float x = ((const struct FloatQuery *)a)->value, y = ((const struct FloatQuery *)b)->value;
+   return (x > y) - (x < y);
+}
+
+void binary_search_int_batch_sorted(int *arr, int size, const int *queries, int count, int *out)
+{
+   struct IntQuery *sorted = malloc(sizeof(struct IntQuery) * (count + 1));
+   if (!sorted) {
+       binary_search_int_batch(arr, size, queries, count, out);
+       return;
+   }
+   for (int i = 0; i < count; i++) {
+       sorted[i].value = queries[i];
+       sorted[i].index = i;
+   }
+   qsort(sorted, count, sizeof(struct IntQuery), __int_query_cmp);
+
+   int lo = 0;
+   for (int i = 0; i < count; i++) {
+       int target = sorted[i].value;
+       int step = 1;
+       while (lo + step < size && arr[lo + step] < target) {
+           step *= 2;
+       }
+       int left = lo + step / 2, right = lo + step < size ? lo + step : size;
+       while (left < right) {
+           int mid = left + (right - left) / 2;
+           if (arr[mid] < target) {
+               left = mid + 1;
+           } else {
+               right = mid;
+           }
+       }
+       lo = left;
+       out[sorted[i].index] = lo < size && arr[lo] == target ? lo : -1;
+   }
+   free(sorted);
+}
+
+void binary_search_float_batch_sorted(float *arr, int size, const float *queries, int count,
+                                      int *out)
+{
+   struct FloatQuery *sorted = malloc(sizeof(struct FloatQuery) * (count + 1));
+   if (!sorted) {
+       binary_search_float_batch(arr, size, queries, count, out);
+       return;
+   }
+   /* NaN never matches and would break the ordering; answer it up front. */
+   int m = 0;
+   for (int i = 0; i < count; i++) {
+       if (queries[i] != queries[i]) {
+           out[i] = -1;
+           continue;
+       }
+       sorted[m].value = queries[i];
+       sorted[m].index = i;
+       m++;
+   }
+   qsort(sorted, m, sizeof(struct FloatQuery), __float_query_cmp);
+
+   int lo = 0;
+   for (int i = 0; i < m; i++) {
+       float target = sorted[i].value;
+       int step = 1;
+       while (lo + step < size && arr[lo + step] < target) {
+           step *= 2;
+       }
+       int left = lo + step / 2, right = lo + step < size ? lo + step : size;
+       while (left < right) {
+           int mid = left + (right - left) / 2;
+           if (arr[mid] < target) {
+               left = mid + 1;
+           } else {
+               right = mid;
+           }
+       }
+       lo = left;
+       out[sorted[i].index] = lo < size && arr[lo] == target ? lo : -1;
+   }
+   free(sorted);
+}
+
+/*
+ * Eytzinger index. Slot k (1-based) has children 2k and 2k + 1, so the
+ * sixteen descendants four levels below k are slots 16k..16k+15: one
+ * cache line when the key array is line-aligned.
+ */
+static void* __aligned_array(size_t count, size_t elem)
+{
+   void *ptr = NULL;
+   if (posix_memalign(&ptr, ARRAY_CACHE_LINE, count * elem) != 0) {
+       return NULL;
+   }
+   return ptr;
+}
+
+static int __eytzinger_fill(int *order, int size, int next, int k)
+{
+   if (k <= size) {
+       next = __eytzinger_fill(order, size, next, 2 * k);
+       order[k] = next++;
+       next = __eytzinger_fill(order, size, next, 2 * k + 1);
+   }
+   return next;
+}
+
+/* Map slot k of the in-order traversal to its sorted position. */
+static int* __eytzinger_order(int size)
+{
+   int *order = malloc(sizeof(int) * (size + 1));
+   if (order) {
+       __eytzinger_fill(order, size, 0, 1);
+   }
+   return order;
+}
+
+/* The descent ends past a leaf; strip the trailing right turns to find the answer. */
+static int __eytzinger_resolve(int k)
+{
+   return k >> ARRAY_FFS(~k);
+}
+
+IntSearchIndex* int_search_index_build(int *arr, int size)
+{
+   if (size > EYTZINGER_MAX_SIZE) {
+       return NULL;
+   }
+   IntSearchIndex *index = malloc(sizeof(IntSearchIndex));
+   int *order = __eytzinger_order(size > 0 ? size : 0);
+   if (!index || !order) {
+       free(index);
+       free(order);
+       return NULL;
+   }
+   index->size = size > 0 ? size : 0;
+   index->keys = __aligned_array(index->size + 1, sizeof(int));
+   index->positions = malloc(sizeof(int) * (index->size + 1));
+   if (!index->keys || !index->positions) {
+       free(order);
+       int_search_index_free(index);
+       return NULL;
+   }
+   for (int k = 1; k <= index->size; k++) {
+       index->keys[k] = arr[order[k]];
+       index->positions[k] = order[k];
+   }
+   free(order);
+   return index;
+}
+
+int int_search_index_find(const IntSearchIndex *index, int target)
+{
+   const int *keys = index->keys;
+   int k = 1;
+   while (k <= index->size) {
+       ARRAY_PREFETCH(keys + (size_t)16 * k);
+       k = 2 * k + (keys[k] < target);
+   }
+   k = __eytzinger_resolve(k);
+   return k && keys[k] == target ? index->positions[k] : -1;
+}
+
+void int_search_index_free(IntSearchIndex *index)
+{
+   free(index->keys);
+   free(index->positions);
+   free(index);
+}
+
+FloatSearchIndex* float_search_index_build(float *arr, int size)
+{
+   if (size > EYTZINGER_MAX_SIZE) {
+       return NULL;
+   }
+   FloatSearchIndex *index = malloc(sizeof(FloatSearchIndex));
+   int *order = __eytzinger_order(size > 0 ? size : 0);
+   if (!index || !order) {
+       free(index);
+       free(order);
+       return NULL;
+   }
+   index->size = size > 0 ? size : 0;
+   index->keys = __aligned_array(index->size + 1, sizeof(float));
+   index->positions = malloc(sizeof(int) * (index->size + 1));
+   if (!index->keys || !index->positions) {
+       free(order);
+       float_search_index_free(index);
+       return NULL;
+   }
+   for (int k = 1; k <= index->size; k++) {
+       index->keys[k] = arr[order[k]];
+       index->positions[k] = order[k];
+   }
+   free(order);
+   return index;
+}
+
+int float_search_index_find(const FloatSearchIndex *index, float target)
+{
+   const float *keys = index->keys;
+   int k = 1;
+   while (k <= index->size) {
+       ARRAY_PREFETCH(keys + (size_t)16 * k);
+       k = 2 * k + (keys[k] < target);
+   }
+   k = __eytzinger_resolve(k);
+   return k && keys[k] == target ? index->positions[k] : -1;
+}
+
+void float_search_index_free(FloatSearchIndex *index)
+{
+   free(index->keys);
+   free(index->positions);
+   free(index);
+}
+
+/*
+ * S+ tree layout (after Algorithmica's "Static B-Trees"). Layer 0 is the
+ * padded sorted array; each layer above has one 16-key node per 17
+ * children below. Key j of a node is the smallest element in the
+ * subtree of child j + 1, so the number of node keys below the target is
+ * the child to descend into. All layers share one line-aligned block.
+ */
+static size_t __btree_blocks(size_t n)
+{
+   return (n + BTREE_NODE - 1) / BTREE_NODE;
+}
+
+static size_t __btree_parent_keys(size_t n)
+{
+   return (__btree_blocks(n) + BTREE_NODE) / (BTREE_NODE + 1) * BTREE_NODE;
+}
+
+/* Fill in the layer offsets; returns the total number of key slots. */
+static size_t __btree_layout(size_t n, int *height, size_t *offsets)
+{
+   size_t total = 0;
+   int h = 0;
+   for (;;) {
+       offsets[h++] = total;
+       total += __btree_blocks(n) * BTREE_NODE;
+       if (n <= BTREE_NODE || h == SEARCH_TREE_MAX_HEIGHT) {
+           break;
+       }
+       n = __btree_parent_keys(n);
+   }
+   *height = h;
+   return total ? total : BTREE_NODE;
+}
+
+/* First element of the leftmost leaf under child j + 1 of node 'node' in layer h. */
+static size_t __btree_separator(size_t node, size_t j, int h)
+{
+   size_t k = node * (BTREE_NODE + 1) + j + 1;
+   for (int l = 1; l < h; l++) {
+       k *= BTREE_NODE + 1;
+   }
+   return k * BTREE_NODE;
+}
+
+static void* __btree_alloc(size_t bytes, int flags, size_t *mapped)
+{
+   *mapped = 0;
+#ifdef MAP_ANONYMOUS
+   if (flags & SEARCH_INDEX_HUGE_PAGES) {
+       /* Over-map so the region can start on a huge-page boundary. */
+       size_t len = (bytes + ARRAY_HUGE_PAGE - 1) & ~(size_t)(ARRAY_HUGE_PAGE - 1);
+       char *raw = mmap(NULL, len + ARRAY_HUGE_PAGE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+       if (raw != MAP_FAILED) {
+           char *start = (char *)(((uintptr_t)raw + ARRAY_HUGE_PAGE - 1)
+                                  & ~(uintptr_t)(ARRAY_HUGE_PAGE - 1));
+           if (start > raw) {
+               munmap(raw, start - raw);
+           }
+           munmap(start + len, raw + ARRAY_HUGE_PAGE - start);
+#ifdef MADV_HUGEPAGE
+           madvise(start, len, MADV_HUGEPAGE);
+#endif
+           *mapped = len;
+           return start;
+       }
+   }
+#endif
+   return __aligned_array(bytes, 1);
+}
+
+static void __btree_release(void *keys, size_t mapped)
+{
+   if (mapped) {
+       munmap(keys, mapped);
+   } else {
+       free(keys);
+   }
+}
+
+/* Number of keys in a 16-key node that are below 'target'. */
+static unsigned int __btree_rank_int(const int *node, int target)
+{
+#if defined(__SSE2__)
+   __m128i x = _mm_set1_epi32(target);
+   __m128i c0 = _mm_cmpgt_epi32(x, _mm_load_si128((const __m128i *)node));
+   __m128i c1 = _mm_cmpgt_epi32(x, _mm_load_si128((const __m128i *)node + 1));
+   __m128i c2 = _mm_cmpgt_epi32(x, _mm_load_si128((const __m128i *)node + 2));
+   __m128i c3 = _mm_cmpgt_epi32(x, _mm_load_si128((const __m128i *)node + 3));
+   __m128i packed = _mm_packs_epi16(_mm_packs_epi32(c0, c1), _mm_packs_epi32(c2, c3));
+   return __builtin_popcount(_mm_movemask_epi8(packed));
+#else
+   unsigned int rank = 0;
+   for (int i = 0; i < BTREE_NODE; i++) {
+       rank += node[i] < target;
+   }
+   return rank;
+#endif
+}
+
+static unsigned int __btree_rank_float(const float *node, float target)
+{
+#if defined(__SSE2__)
+   __m128 x = _mm_set1_ps(target);
+   __m128i c0 = _mm_castps_si128(_mm_cmplt_ps(_mm_load_ps(node), x));
+   __m128i c1 = _mm_castps_si128(_mm_cmplt_ps(_mm_load_ps(node + 4), x));
+   __m128i c2 = _mm_castps_si128(_mm_cmplt_ps(_mm_load_ps(node + 8), x));
+   __m128i c3 = _mm_castps_si128(_mm_cmplt_ps(_mm_load_ps(node + 12), x));
+   __m128i packed = _mm_packs_epi16(_mm_packs_epi32(c0, c1), _mm_packs_epi32(c2, c3));
+   return __builtin_popcount(_mm_movemask_epi8(packed));
+#else
+   unsigned int rank = 0;
+   for (int i = 0; i < BTREE_NODE; i++) {
+       rank += node[i] < target;
+   }
+   return rank;
+#endif
+}
+
+IntBTreeIndex* int_btree_index_build(int *arr, int size, int flags)
+{
+   IntBTreeIndex *index = malloc(sizeof(IntBTreeIndex));
+   if (!index) {
+       return NULL;
+   }
+   size_t n = size > 0 ? size : 0;
+   size_t total = __btree_layout(n, &index->height, index->offsets);
+   index->size = (int)n;
+   index->keys = __btree_alloc(total * sizeof(int), flags, &index->mapped);
+   if (!index->keys) {
+       free(index);
+       return NULL;
+   }
+
+   size_t leaves = index->height > 1 ? index->offsets[1] : total;
+   for (size_t i = 0; i < leaves; i++) {
+       index->keys[i] = i < n ? arr[i] : INT_MAX;
+   }
+   for (int h = 1; h < index->height; h++) {
+       size_t end = h + 1 < index->height ? index->offsets[h + 1] : total;
+       for (size_t i = 0; index->offsets[h] + i < end; i++) {
+           size_t first = __btree_separator(i / BTREE_NODE, i % BTREE_NODE, h);
+           index->keys[index->offsets[h] + i] = first < n ? arr[first] : INT_MAX;
+       }
+   }
+   return index;
+}
+
+int int_btree_index_lower_bound(const IntBTreeIndex *index, int target)
+{
+   size_t k = 0;
+   for (int h = index->height - 1; h > 0; h--) {
+       unsigned int i = __btree_rank_int(index->keys + index->offsets[h] + k, target);
+       k = k * (BTREE_NODE + 1) + i * BTREE_NODE;
+       ARRAY_PREFETCH(index->keys + index->offsets[h - 1] + k);
+   }
+   k += __btree_rank_int(index->keys + k, target);
+   return k < (size_t)index->size ? (int)k : index->size;
+}
+
+int int_btree_index_find(const IntBTreeIndex *index, int target)
+{
+   int idx = int_btree_index_lower_bound(index, target);
+   return idx < index->size && index->keys[idx] == target ? idx : -1;
+}
+
+int int_btree_index_range_count(const IntBTreeIndex *index, int lo, int hi)
+{
+   if (hi <= lo) {
+       return 0;
+   }
+   return int_btree_index_lower_bound(index, hi) - int_btree_index_lower_bound(index, lo);
+}
+
+void int_btree_index_free(IntBTreeIndex *index)
+{
+   __btree_release(index->keys, index->mapped);
+   free(index);
+}
+
+FloatBTreeIndex* float_btree_index_build(float *arr, int size, int flags)
+{
+   FloatBTreeIndex *index = malloc(sizeof(FloatBTreeIndex));
+   if (!index) {
+       return NULL;
+   }
+   size_t n = size > 0 ? size : 0;
+   size_t total = __btree_layout(n, &index->height, index->offsets);
+   index->size = (int)n;
+   index->keys = __btree_alloc(total * sizeof(float), flags, &index->mapped);
+   if (!index->keys) {
+       free(index);
+       return NULL;
+   }
+
+   size_t leaves = index->height > 1 ? index->offsets[1] : total;
+   for (size_t i = 0; i < leaves; i++) {
+       index->keys[i] = i < n ? arr[i] : INFINITY;
+   }
+   for (int h = 1; h < index->height; h++) {
+       size_t end = h + 1 < index->height ? index->offsets[h + 1] : total;
+       for (size_t i = 0; index->offsets[h] + i < end; i++) {
+           size_t first = __btree_separator(i / BTREE_NODE, i % BTREE_NODE, h);
+           index->keys[index->offsets[h] + i] = first < n ? arr[first] : INFINITY;
+       }
+   }
+   return index;
+}
+
+int float_btree_index_lower_bound(const FloatBTreeIndex *index, float target)
+{
+   size_t k = 0;
+   for (int h = index->height - 1; h > 0; h--) {
+       unsigned int i = __btree_rank_float(index->keys + index->offsets[h] + k, target);
+       k = k * (BTREE_NODE + 1) + i * BTREE_NODE;
+       ARRAY_PREFETCH(index->keys + index->offsets[h - 1] + k);
+   }
+   k += __btree_rank_float(index->keys + k, target);
+   return k < (size_t)index->size ? (int)k : index->size;
+}
+
+int float_btree_index_find(const FloatBTreeIndex *index, float target)
+{
+   int idx = float_btree_index_lower_bound(index, target);
+   return idx < index->size && index->keys[idx] == target ? idx : -1;
+}
+
+int float_btree_index_range_count(const FloatBTreeIndex *index, float lo, float hi)
+{
+   if (!(lo < hi)) {
+       return 0;
+   }
+   return float_btree_index_lower_bound(index, hi) - float_btree_index_lower_bound(index, lo);
+}
+
+void float_btree_index_free(FloatBTreeIndex *index)
+{
+   __btree_release(index->keys, index->mapped);
+   free(index);
+}
+
+/*
+ * Shrinking-cone segmentation: a segment is anchored at its first key and
+ * keeps the range of slopes that still predict every later key to within
+ * epsilon. A key that leaves the range starts a new segment. Duplicates are
+ * skipped so each key maps to its first position.
+ */
+IntLearnedIndex* int_learned_index_build(int *arr, int size, int epsilon)
+{
+   IntLearnedIndex *index = malloc(sizeof(IntLearnedIndex));
+   if (!index) {
+       return NULL;
+   }
+   index->arr = arr;
+   index->size = size > 0 ? size : 0;
+   index->epsilon = epsilon > 0 ? epsilon : LEARNED_INDEX_EPSILON;
+   index->segment_count = 0;
+   index->segments = malloc(sizeof(LearnedSegment) * (index->size + 1));
+   if (!index->segments) {
+       free(index);
+       return NULL;
+   }
+
+   LearnedSegment *seg = NULL;
+   double lo = 0, hi = 0;
+   for (int i = 0; i < index->size; i++) {
+       if (i > 0 && arr[i] == arr[i - 1]) {
+           continue;
+       }
+       if (seg) {
+           double dx = (double)arr[i] - seg->key;
+           double dy = (double)i - seg->position;
+           double min = (dy - index->epsilon) / dx;
+           double max = (dy + index->epsilon) / dx;
+           if (min <= hi && max >= lo) {
+               lo = min > lo ? min : lo;
+               hi = max < hi ? max : hi;
+               continue;
+           }
+           seg->slope = (lo + hi) / 2;
+       }
+       seg = &index->segments[index->segment_count++];
+       seg->key = arr[i];
+       seg->position = i;
+       lo = 0;
+       hi = (double)index->size;
+   }
+   if (seg) {
+       seg->slope = (lo + hi) / 2;
+   }
+   LearnedSegment *shrunk = realloc(index->segments,
+                                    sizeof(LearnedSegment) * (index->segment_count + 1));
+   if (shrunk) {
+       index->segments = shrunk;
+   }
+   return index;
+}
+
+int int_learned_index_find(const IntLearnedIndex *index, int target)
+{
+   if (index->segment_count == 0 || target < index->segments[0].key) {
+       return -1;
+   }
+   /* Last segment whose first key is <= target. */
+   const LearnedSegment *seg = index->segments;
+   int n = index->segment_count;
+   while (n > 1) {
+       int half = n / 2;
+       seg = seg[half].key <= target ? seg + half : seg;
+       n -= half;
+   }
+
+   long end = seg + 1 < index->segments + index->segment_count ? seg[1].position : index->size;
+   double predicted = seg->position + seg->slope * ((double)target - seg->key);
+   predicted = predicted < (double)end ? predicted : (double)end;
+   long lo = (long)predicted - index->epsilon;
+   long hi = (long)predicted + index->epsilon + 2;
+   lo = lo < seg->position ? seg->position : lo;
+   hi = hi > end ? end : hi;
+   if (lo >= hi) {
+       return -1;
+   }
+
+   const int *base = index->arr + lo;
+   long len = hi - lo;
+   while (len > 1) {
+       long half = len / 2;
+       base = base[half] < target ? base + half : base;
+       len -= half;
+   }
+   int idx = (int)(base - index->arr) + (*base < target);
+   return idx < hi && index->arr[idx] == target ? idx : -1;
+}
+
+void int_learned_index_free(IntLearnedIndex *index)
+{
+   free(index->segments);
+   free(index);
+}
@@ -0,0 +1,548 @@
+/*
+ * concurrent_hash_lookup.c - Thread-safe hash table
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <lookup/concurrent_hash_lookup.h>
+#include <lookup/hash_lookup.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHT_STRIPES           64    /* writer lock stripes, also the minimum bucket count */
+#define CHT_MIGRATE_BATCH     4     /* buckets moved per write while resizing */
+#define CHT_RECLAIM_EVERY     64    /* retirements per stripe between reclamation passes */
+
+/*
+ * Epoch-based reclamation.
+ *
+ * Every thread owns a record whose state is (epoch << 1) | 1 while it is
+ * inside the table and 0 otherwise. The global epoch only advances once
+ * every active record has caught up with it, so anything retired in epoch
+ * e is unreachable by all readers once the global epoch reaches e + 2.
+ * Records are never freed; a thread's record is recycled after it exits.
+ */
+struct EpochRecord {
+   atomic_ulong state;
+   atomic_int in_use;
+   struct EpochRecord *next;
+};
+
+static _Atomic(struct EpochRecord*) epoch_records;
+static atomic_ulong global_epoch = 1;
+static _Thread_local struct EpochRecord *epoch_local;
+static _Thread_local int epoch_depth;
+static pthread_key_t epoch_key;
+static pthread_once_t epoch_once = PTHREAD_ONCE_INIT;
+
+static void __epoch_release(void *record)
+{
+   atomic_store(&((struct EpochRecord *)record)->in_use, 0);
+}
+
+static void __epoch_init(void)
+{
+   pthread_key_create(&epoch_key, __epoch_release);
+}
+
+static struct EpochRecord* __epoch_record(void)
+{
+   if (epoch_local) {
+       return epoch_local;
+   }
+   pthread_once(&epoch_once, __epoch_init);
+
+   struct EpochRecord *record;
+   for (record = atomic_load(&epoch_records); record; record = record->next) {
+       int idle = 0;
+       if (atomic_compare_exchange_strong(&record->in_use, &idle, 1)) {
+           break;
+       }
+   }
+   if (!record) {
+       record = calloc(1, sizeof(struct EpochRecord));
+       if (!record) {
+           return NULL;
+       }
+       atomic_init(&record->in_use, 1);
+       record->next = atomic_load(&epoch_records);
+       while (!atomic_compare_exchange_weak(&epoch_records, &record->next, record)) {
+       }
+   }
+   pthread_setspecific(epoch_key, record);
+   epoch_local = record;
+   return record;
+}
+
+static struct EpochRecord* __epoch_enter(void)
+{
+   struct EpochRecord *record = __epoch_record();
+   if (record && epoch_depth++ == 0) {
+       atomic_store(&record->state, (atomic_load(&global_epoch) << 1) | 1);
+       atomic_thread_fence(memory_order_seq_cst);
+   }
+   return record;
+}
+
+static void __epoch_exit(struct EpochRecord *record)
+{
+   if (--epoch_depth == 0) {
+       atomic_store_explicit(&record->state, 0, memory_order_release);
+   }
+}
+
+static unsigned long __epoch_try_advance(void)
+{
+   unsigned long epoch = atomic_load(&global_epoch);
+   for (struct EpochRecord *r = atomic_load(&epoch_records); r; r = r->next) {
+       unsigned long state = atomic_load(&r->state);
+       if ((state & 1) && (state >> 1) != epoch) {
+           return epoch;  // someone is still reading in an older epoch
+       }
+   }
+   atomic_compare_exchange_strong(&global_epoch, &epoch, epoch + 1);
+   return atomic_load(&global_epoch);
+}
+
+/*
+ * Table layout: an array of bucket chains. Chain nodes are immutable apart
+ * from 'next' and 'value', so a reader never sees a half-built node.
+ * Anything unlinked starts with a Retired header and is freed with free().
+ */
+struct Retired {
+   struct Retired *next;
+   unsigned long epoch;
+};
+
+struct ChtNode {
+   struct Retired retired;
+   _Atomic(struct ChtNode*) next;
+   _Atomic(void*) value;
+   uint64_t hash;
+   char key[];
+};
+
+/*
+ * While resizing, 'next' points to the array twice the size. A bucket
+ * whose chain has been copied there holds CHT_MOVED, which sends readers
+ * and writers on to 'next'.
+ */
+struct ChtBuckets {
+   struct Retired retired;
+   _Atomic(struct ChtBuckets*) next;
+   atomic_size_t migrate_claim;
+   atomic_size_t migrate_done;
+   size_t mask;
+   _Atomic(struct ChtNode*) slots[];
+};
+
+/*
+ * Writers serialize per stripe. Each stripe also keeps the objects retired
+ * under its lock, so unlinking and reclaiming never take a table-wide lock.
+ */
+struct ChtStripe {
+   pthread_mutex_t lock;
+   struct Retired *retired;
+   atomic_int retired_count;
+};
+
+struct ConcurrentHashTable {
+   _Atomic(struct ChtBuckets*) buckets;
+   atomic_int size;
+   struct ChtStripe stripes[CHT_STRIPES];
+   pthread_mutex_t resize_lock;
+   uint64_t seed;
+};
+
+static struct ChtNode __cht_moved;
+#define CHT_MOVED (&__cht_moved)
+
+static uint64_t __hash_key(const ConcurrentHashTable *table, const char *key)
+{
+   return lookup_hash64(key, strlen(key), table->seed);
+}
+
+static struct ChtBuckets* __cht_buckets_alloc(size_t count)
+{
+   struct ChtBuckets *buckets = malloc(sizeof(struct ChtBuckets)
+                                       + count * sizeof(buckets->slots[0]));
+   if (!buckets) {
+       return NULL;
+   }
+   atomic_init(&buckets->next, NULL);
+   atomic_init(&buckets->migrate_claim, 0);
+   atomic_init(&buckets->migrate_done, 0);
+   buckets->mask = count - 1;
+   for (size_t i = 0; i < count; i++) {
+       atomic_init(&buckets->slots[i], NULL);
+   }
+   return buckets;
+}
+
+static struct ChtNode* __cht_node_alloc(const char *key, uint64_t hash, void *value)
+{
+   size_t len = strlen(key) + 1;
+   struct ChtNode *node = malloc(sizeof(struct ChtNode) + len);
+   if (!node) {
+       return NULL;
+   }
+   atomic_init(&node->next, NULL);
+   atomic_init(&node->value, value);
+   node->hash = hash;
+   memcpy(node->key, key, len);
+   return node;
+}
+
+static struct ChtStripe* __cht_stripe(ConcurrentHashTable *table, uint64_t hash)
+{
+   return &table->stripes[hash & (CHT_STRIPES - 1)];
+}
+
+/* Caller holds stripe->lock. */
+static void __cht_retire(struct ChtStripe *stripe, struct Retired *object)
+{
+   /* Order the unlink before sampling the epoch it is tagged with. */
+   atomic_thread_fence(memory_order_seq_cst);
+   object->epoch = atomic_load(&global_epoch);
+   object->next = stripe->retired;
+   stripe->retired = object;
+   atomic_fetch_add_explicit(&stripe->retired_count, 1, memory_order_relaxed);
+}
+
+/* Called outside any epoch, otherwise our own record would hold the epoch back. */
+static void __cht_reclaim(struct ChtStripe *stripe)
+{
+   if (atomic_load_explicit(&stripe->retired_count, memory_order_relaxed)
+       < CHT_RECLAIM_EVERY) {
+       return;
+   }
+   pthread_mutex_lock(&stripe->lock);
+   unsigned long epoch = __epoch_try_advance();
+   int count = atomic_load_explicit(&stripe->retired_count, memory_order_relaxed);
+   struct Retired **link = &stripe->retired;
+   while (*link) {
+       struct Retired *object = *link;
+       if (object->epoch + 2 <= epoch) {
+           *link = object->next;
+           count--;
+           free(object);
+       } else {
+           link = &object->next;
+       }
+   }
+   atomic_store_explicit(&stripe->retired_count, count, memory_order_relaxed);
+   pthread_mutex_unlock(&stripe->lock);
+}
+
+/*
+ * Copy the chain of old bucket 'i' into the two buckets it splits into,
+ * then mark it moved. Readers already walking the old chain finish on
+ * the old nodes, which stay alive until their epoch ends. Runs under the
+ * lock of 'stripe', the stripe of 'i'; returns 0 if the copies could not
+ * be allocated.
+ */
+static int __cht_migrate_bucket(struct ChtStripe *stripe, struct ChtBuckets *old,
+                                struct ChtBuckets *next, size_t i)
+{
+   struct ChtNode *chain = atomic_load_explicit(&old->slots[i], memory_order_relaxed);
+   if (chain == CHT_MOVED) {
+       return 1;
+   }
+
+   struct ChtNode *heads[2] = { NULL, NULL };
+   for (struct ChtNode *node = chain; node;
+        node = atomic_load_explicit(&node->next, memory_order_relaxed)) {
+       struct ChtNode *copy = __cht_node_alloc(node->key, node->hash,
+                                               atomic_load(&node->value));
+       if (!copy) {
+           for (int h = 0; h < 2; h++) {
+               while (heads[h]) {
+                   struct ChtNode *n = atomic_load_explicit(&heads[h]->next,
+                                                            memory_order_relaxed);
+                   free(heads[h]);
+                   heads[h] = n;
+               }
+           }
+           return 0;
+       }
+       int high = (node->hash & (old->mask + 1)) != 0;
+       atomic_init(&copy->next, heads[high]);
+       heads[high] = copy;
+   }
+
+   atomic_store_explicit(&next->slots[i], heads[0], memory_order_release);
+   atomic_store_explicit(&next->slots[i + old->mask + 1], heads[1], memory_order_release);
+   atomic_store_explicit(&old->slots[i], CHT_MOVED, memory_order_release);
+
+   while (chain) {
+       struct ChtNode *n = atomic_load_explicit(&chain->next, memory_order_relaxed);
+       __cht_retire(stripe, &chain->retired);
+       chain = n;
+   }
+   return 1;
+}
+
+/*
+ * Move a few buckets of an in-progress resize. Each bucket is claimed by
+ * exactly one helper; whoever completes the last one publishes the new
+ * array. Buckets skipped for lack of memory are retried by a later sweep.
+ * Must be called inside an epoch and without holding a stripe lock.
+ */
+static void __cht_help_resize(ConcurrentHashTable *table, int budget)
+{
+   struct ChtBuckets *old = atomic_load(&table->buckets);
+   struct ChtBuckets *next = atomic_load(&old->next);
+   if (!next) {
+       return;
+   }
+   size_t count = old->mask + 1;
+   while (budget-- > 0) {
+       size_t i = atomic_fetch_add(&old->migrate_claim, 1);
+       if (i >= count) {
+           i %= count;  // sweep for buckets an earlier helper had to skip
+       }
+       struct ChtStripe *stripe = __cht_stripe(table, i);
+       pthread_mutex_lock(&stripe->lock);
+       int pending = atomic_load_explicit(&old->slots[i], memory_order_relaxed) != CHT_MOVED;
+       int moved = pending && __cht_migrate_bucket(stripe, old, next, i);
+       pthread_mutex_unlock(&stripe->lock);
+
+       if (moved && atomic_fetch_add(&old->migrate_done, 1) + 1 == count) {
+           pthread_mutex_lock(&table->resize_lock);
+           atomic_store(&table->buckets, next);
+           pthread_mutex_unlock(&table->resize_lock);
+           pthread_mutex_lock(&stripe->lock);
+           __cht_retire(stripe, &old->retired);
+           pthread_mutex_unlock(&stripe->lock);
+           return;
+       }
+   }
+}
+
+static int __cht_needs_resize(ConcurrentHashTable *table, struct ChtBuckets *current)
+{
+   return !atomic_load(&current->next)
+          && (size_t)atomic_load(&table->size) > current->mask + 1;
+}
+
+static void __cht_start_resize(ConcurrentHashTable *table)
+{
+   if (!__cht_needs_resize(table, atomic_load(&table->buckets))) {
+       return;  // the common case: no lock once the table is big enough
+   }
+   pthread_mutex_lock(&table->resize_lock);
+   struct ChtBuckets *current = atomic_load(&table->buckets);
+   if (__cht_needs_resize(table, current)) {
+       struct ChtBuckets *next = __cht_buckets_alloc((current->mask + 1) * 2);
+       if (next) {
+           atomic_store(&current->next, next);
+       }
+   }
+   pthread_mutex_unlock(&table->resize_lock);
+}
+
+/* The slot currently owning 'hash'. Caller holds the hash's stripe lock. */
+static _Atomic(struct ChtNode*)* __cht_slot(ConcurrentHashTable *table, uint64_t hash)
+{
+   struct ChtBuckets *buckets = atomic_load(&table->buckets);
+   _Atomic(struct ChtNode*) *slot = &buckets->slots[hash & buckets->mask];
+   while (atomic_load_explicit(slot, memory_order_acquire) == CHT_MOVED) {
+       buckets = atomic_load(&buckets->next);
+       slot = &buckets->slots[hash & buckets->mask];
+   }
+   return slot;
+}
+
+ConcurrentHashTable* concurrent_hash_table_create(int capacity)
+{
+   ConcurrentHashTable *table = malloc(sizeof(ConcurrentHashTable));
+   if (!table) {
+       return NULL;
+   }
+   if (capacity <= 0) {
+       capacity = CHT_STRIPES;
+   }
+   size_t count = CHT_STRIPES;
+   while (count < (size_t)capacity && count <= SIZE_MAX / 2) {
+       count <<= 1;
+   }
+   struct ChtBuckets *buckets = __cht_buckets_alloc(count);
+   if (!buckets) {
+       free(table);
+       return NULL;
+   }
+   atomic_init(&table->buckets, buckets);
+   atomic_init(&table->size, 0);
+   for (int i = 0; i < CHT_STRIPES; i++) {
+       pthread_mutex_init(&table->stripes[i].lock, NULL);
+       table->stripes[i].retired = NULL;
+       atomic_init(&table->stripes[i].retired_count, 0);
+   }
+   pthread_mutex_init(&table->resize_lock, NULL);
+   table->seed = lookup_hash_seed();
+   return table;
+}
+
+int concurrent_hash_lookup(ConcurrentHashTable *table, const char *key, void **value)
+{
+   uint64_t hash = __hash_key(table, key);
+   struct EpochRecord *record = __epoch_enter();
+   if (!record) {
+       return 0;
+   }
+
+   struct ChtBuckets *buckets = atomic_load_explicit(&table->buckets, memory_order_acquire);
+   struct ChtNode *node = atomic_load_explicit(&buckets->slots[hash & buckets->mask],
+                                               memory_order_acquire);
+   while (node == CHT_MOVED) {
+       buckets = atomic_load_explicit(&buckets->next, memory_order_acquire);
+       node = atomic_load_explicit(&buckets->slots[hash & buckets->mask],
+                                   memory_order_acquire);
+   }
+
+   int found = 0;
+   for (; node; node = atomic_load_explicit(&node->next, memory_order_acquire)) {
+       if (node->hash == hash && strcmp(node->key, key) == 0) {
+           *value = atomic_load_explicit(&node->value, memory_order_acquire);
+           found = 1;
+           break;
+       }
+   }
+   __epoch_exit(record);
+   return found;
+}
+
+int concurrent_hash_insert(ConcurrentHashTable *table, const char *key, void *value)
+{
+   uint64_t hash = __hash_key(table, key);
+   struct EpochRecord *record = __epoch_enter();
+   if (!record) {
+       return 0;
+   }
+   __cht_help_resize(table, CHT_MIGRATE_BATCH);
+
+   struct ChtStripe *stripe = __cht_stripe(table, hash);
+   pthread_mutex_lock(&stripe->lock);
+   _Atomic(struct ChtNode*) *slot = __cht_slot(table, hash);
+   struct ChtNode *head = atomic_load_explicit(slot, memory_order_relaxed);
+   for (struct ChtNode *node = head; node;
+        node = atomic_load_explicit(&node->next, memory_order_relaxed)) {
+       if (node->hash == hash && strcmp(node->key, key) == 0) {
+           atomic_store_explicit(&node->value, value, memory_order_release);
+           pthread_mutex_unlock(&stripe->lock);
+           __epoch_exit(record);
+           return 1;
+       }
+   }
+
+   struct ChtNode *node = __cht_node_alloc(key, hash, value);
+   if (!node) {
+       pthread_mutex_unlock(&stripe->lock);
+       __epoch_exit(record);
+       return 0;
+   }
+   atomic_init(&node->next, head);
+   atomic_store_explicit(slot, node, memory_order_release);
+   pthread_mutex_unlock(&stripe->lock);
+
+   atomic_fetch_add(&table->size, 1);
+   __cht_start_resize(table);
+   __epoch_exit(record);
+   __cht_reclaim(stripe);
+   return 1;
+}
+
+int concurrent_hash_remove(ConcurrentHashTable *table, const char *key)
+{
+   uint64_t hash = __hash_key(table, key);
+   struct EpochRecord *record = __epoch_enter();
+   if (!record) {
+       return 0;
+   }
+   __cht_help_resize(table, CHT_MIGRATE_BATCH);
+
+   struct ChtStripe *stripe = __cht_stripe(table, hash);
+   pthread_mutex_lock(&stripe->lock);
+   _Atomic(struct ChtNode*) *link = __cht_slot(table, hash);
+   struct ChtNode *node;
+   while ((node = atomic_load_explicit(link, memory_order_relaxed))) {
+       if (node->hash == hash && strcmp(node->key, key) == 0) {
+           break;
+       }
+       link = &node->next;
+   }
+   if (node) {
+       atomic_store_explicit(link, atomic_load_explicit(&node->next, memory_order_relaxed),
+                             memory_order_release);
+       __cht_retire(stripe, &node->retired);
+   }
+   pthread_mutex_unlock(&stripe->lock);
+
+   if (node) {
+       atomic_fetch_sub(&table->size, 1);
+   }
+   __epoch_exit(record);
+   __cht_reclaim(stripe);
+   return node != NULL;
+}
+
+int concurrent_hash_size(ConcurrentHashTable *table)
+{
+   return atomic_load(&table->size);
+}
+
+static void __cht_free_chains(struct ChtBuckets *buckets)
+{
+   for (size_t i = 0; i <= buckets->mask; i++) {
+       struct ChtNode *node = atomic_load(&buckets->slots[i]);
+       if (node == CHT_MOVED) {
+           continue;
+       }
+       while (node) {
+           struct ChtNode *next = atomic_load(&node->next);
+           free(node);
+           node = next;
+       }
+   }
+}
+
+void concurrent_hash_table_free(ConcurrentHashTable *table)
+{
+   struct ChtBuckets *buckets = atomic_load(&table->buckets);
+   struct ChtBuckets *next = atomic_load(&buckets->next);
+   __cht_free_chains(buckets);
+   if (next) {
+       __cht_free_chains(next);
+       free(next);
+   }
+   free(buckets);
+
+   for (int i = 0; i < CHT_STRIPES; i++) {
+       while (table->stripes[i].retired) {
+           struct Retired *object = table->stripes[i].retired;
+           table->stripes[i].retired = object->next;
+           free(object);
+       }
+       pthread_mutex_destroy(&table->stripes[i].lock);
+   }
+   pthread_mutex_destroy(&table->resize_lock);
+   free(table);
+}
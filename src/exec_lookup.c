@@ -20,9 +20,18 @@
  */
 
 #include <lookup/exec_lookup.h>
+#include <lookup/hash_lookup.h>
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #ifdef PLATFORM_MACHO
@@ -32,158 +41,1628 @@
 #include <elf.h>
 #endif /* PLATFORM_MACHO */
 
+#define EXEC_BATCH            16    /* lookups in flight per batched call */
+
+#if defined(__GNUC__)
+#define EXEC_PREFETCH(addr)   __builtin_prefetch(addr)
+#else
+#define EXEC_PREFETCH(addr)   ((void)(addr))
+#endif
+
 /* Linux and FreeBSD (ELF format) */
 #ifdef PLATFORM_ELF
-static char* __read_string_table(int fd, Elf64_Shdr* shdr)
+/*
+ * An ELF file mapped read-only once. Section contents are used in place;
+ * every offset and size taken from the file is checked against the
+ * mapping before it is dereferenced.
+ */
+struct ElfMap {
+    const unsigned char* base;
+    size_t size;
+    const Elf64_Shdr* sections;
+    size_t section_count;
+    size_t shstrndx;
+};
+
+static int __elf_range_ok(const struct ElfMap* map, uint64_t offset, uint64_t size)
+{
+    return offset <= map->size && size <= map->size - offset;
+}
+
+/* Returns 1 when mapped, 0 for a malformed file, -1 if the fd cannot be mapped. */
+static int __elf_map(int fd, struct ElfMap* map)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(Elf64_Ehdr)) {
+        return 0;
+    }
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+    map->base = base;
+    map->size = st.st_size;
+
+    const Elf64_Ehdr* ehdr = base;
+    int valid = memcmp(ehdr->e_ident, ELFMAG, SELFMAG) == 0
+                && ehdr->e_ident[EI_CLASS] == ELFCLASS64
+                && ehdr->e_shentsize == sizeof(Elf64_Shdr)
+                && ehdr->e_shoff % sizeof(uint64_t) == 0
+                && __elf_range_ok(map, ehdr->e_shoff, sizeof(Elf64_Shdr));
+    if (valid) {
+        map->sections = (const Elf64_Shdr*)(map->base + ehdr->e_shoff);
+        /* Extended numbering keeps the real counts in section 0. */
+        map->section_count = ehdr->e_shnum ? ehdr->e_shnum : map->sections[0].sh_size;
+        map->shstrndx = ehdr->e_shstrndx != SHN_XINDEX ? ehdr->e_shstrndx
+                                                       : map->sections[0].sh_link;
+        valid = map->section_count <= (map->size - ehdr->e_shoff) / sizeof(Elf64_Shdr);
+    }
+    if (!valid) {
+        munmap(base, map->size);
+        return 0;
+    }
+    return 1;
+}
+
+static void __elf_unmap(struct ElfMap* map)
+{
+    munmap((void*)map->base, map->size);
+}
+
+/* Section contents in the mapping, or NULL if they lie outside it. */
+static const void* __elf_section_data(const struct ElfMap* map, const Elf64_Shdr* shdr)
+{
+    if (shdr->sh_type == SHT_NOBITS || !__elf_range_ok(map, shdr->sh_offset, shdr->sh_size)) {
+        return NULL;
+    }
+    return map->base + shdr->sh_offset;
+}
+
+static void __elf_advise(const struct ElfMap* map, const Elf64_Shdr* shdr, int advice)
+{
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)(map->base + shdr->sh_offset) & ~(page - 1);
+    uintptr_t end = (uintptr_t)(map->base + shdr->sh_offset + shdr->sh_size);
+    madvise((void*)start, end - start, advice);
+}
+
+/*
+ * The rules a symbol entry can satisfy. A lookup asks for one of them:
+ * EXEC_RULE_TYPED by default, as find_symbol_in_executable() always has,
+ * EXEC_RULE_DEFINED with EXEC_LOOKUP_DEFINED, in handles and in scans.
+ */
+#define EXEC_RULE_TYPED       0x1   /* a function or object, defined or imported */
+#define EXEC_RULE_DEFINED     0x2   /* defined here, other than a section or file entry */
+
+static unsigned int __elf_symbol_rules(const Elf64_Sym* sym)
+{
+    unsigned char type = ELF64_ST_TYPE(sym->st_info);
+    unsigned int rules = 0;
+    if (type == STT_FUNC || type == STT_OBJECT) {
+        rules |= EXEC_RULE_TYPED;
+    }
+    if (sym->st_shndx != SHN_UNDEF && type != STT_SECTION && type != STT_FILE) {
+        rules |= EXEC_RULE_DEFINED;
+    }
+    return rules;
+}
+
+static unsigned int __exec_rule(int flags)
+{
+    return flags & EXEC_LOOKUP_DEFINED ? EXEC_RULE_DEFINED : EXEC_RULE_TYPED;
+}
+
+/* Whether string 'name' of a string table is exactly 'symbol' ('len' bytes). */
+static int __elf_name_equals(const char* strtab, size_t strtab_size, Elf64_Word name,
+                             const char* symbol, size_t len)
+{
+    return name < strtab_size && len < strtab_size - name && strtab[name + len] == '\0'
+           && memcmp(strtab + name, symbol, len) == 0;
+}
+
+/*
+ * Walk the symbol table in place. Its string table is the one named by
+ * sh_link, as the ELF spec defines.
+ */
+static int __elf_find_in_symtab(const struct ElfMap* map, const char* symbol, unsigned int rule)
+{
+    const Elf64_Shdr* symtab_hdr = NULL;
+    for (size_t i = 0; i < map->section_count; i++) {
+        if (map->sections[i].sh_type == SHT_SYMTAB) {
+            symtab_hdr = &map->sections[i];
+            break;
+        }
+    }
+    if (!symtab_hdr || symtab_hdr->sh_link >= map->section_count
+        || symtab_hdr->sh_entsize != sizeof(Elf64_Sym)) {
+        return -1;
+    }
+    const Elf64_Shdr* strtab_hdr = &map->sections[symtab_hdr->sh_link];
+    const Elf64_Sym* syms = __elf_section_data(map, symtab_hdr);
+    const char* strtab = __elf_section_data(map, strtab_hdr);
+    if (!syms || !strtab || symtab_hdr->sh_offset % sizeof(uint64_t) != 0) {
+        return -1;
+    }
+#ifdef MADV_SEQUENTIAL
+    __elf_advise(map, symtab_hdr, MADV_SEQUENTIAL);
+    __elf_advise(map, strtab_hdr, MADV_WILLNEED);
+#endif
+
+    size_t len = strlen(symbol);
+    size_t num_symbols = symtab_hdr->sh_size / sizeof(Elf64_Sym);
+    for (size_t i = 0; i < num_symbols; i++) {
+        const Elf64_Sym* sym = &syms[i];
+        if (sym->st_name != 0 && (__elf_symbol_rules(sym) & rule)
+            && __elf_name_equals(strtab, strtab_hdr->sh_size, sym->st_name, symbol, len)) {
+            return 1;
+        }
+    }
+    return -1;
+}
+
+/* GNU symbol hash (DJB). */
+static uint32_t __gnu_hash(const char* name)
+{
+    uint32_t h = 5381;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        h = h * 33 + *p;
+    }
+    return h;
+}
+
+/* SysV ELF symbol hash. */
+static uint32_t __sysv_hash(const char* name)
+{
+    uint32_t h = 0;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        h = (h << 4) + *p;
+        uint32_t g = h & 0xf0000000;
+        if (g) {
+            h ^= g >> 24;
+        }
+        h &= ~g;
+    }
+    return h;
+}
+
+/* A dynamic symbol of this name that satisfies 'rule'. */
+static int __dynsym_matches(const Elf64_Sym* sym, const char* strtab, size_t strtab_size,
+                            const char* symbol, size_t len, unsigned int rule)
+{
+    return (__elf_symbol_rules(sym) & rule)
+           && __elf_name_equals(strtab, strtab_size, sym->st_name, symbol, len);
+}
+
+/*
+ * .gnu.hash: a Bloom filter rejects most absent names outright; otherwise
+ * the bucket gives the first symbol of a hash-sorted run, and the chain
+ * holds each symbol's hash with the low bit marking the end of the run.
+ * Only the symbols from 'symoffset' on are hashed; the ones before it are
+ * the imports, which are compared one by one when the rule accepts them.
+ */
+static int __elf_gnu_hash_find(const struct ElfMap* map, const Elf64_Shdr* hash_hdr,
+                               const Elf64_Sym* syms, size_t num_syms, const char* strtab,
+                               size_t strtab_size, const char* symbol, unsigned int rule)
+{
+    const uint32_t* table = __elf_section_data(map, hash_hdr);
+    size_t words = hash_hdr->sh_size / sizeof(uint32_t);
+    if (!table || hash_hdr->sh_offset % sizeof(uint64_t) != 0 || words < 4) {
+        return -1;
+    }
+    uint32_t nbuckets = table[0], symoffset = table[1];
+    uint32_t bloom_size = table[2], bloom_shift = table[3];
+    /* 64-bit Bloom words, then buckets, then the chain to the end. */
+    if (nbuckets == 0 || bloom_size == 0 || (bloom_size & (bloom_size - 1)) != 0
+        || (size_t)bloom_size * 2 + nbuckets > words - 4) {
+        return -1;
+    }
+    const uint64_t* bloom = (const uint64_t*)(table + 4);
+    const uint32_t* buckets = table + 4 + (size_t)bloom_size * 2;
+    const uint32_t* chain = buckets + nbuckets;
+    size_t chain_len = words - 4 - (size_t)bloom_size * 2 - nbuckets;
+
+    uint32_t h = __gnu_hash(symbol);
+    uint64_t word = bloom[(h / 64) & (bloom_size - 1)];
+    uint64_t mask = (uint64_t)1 << (h % 64) | (uint64_t)1 << ((h >> (bloom_shift & 31)) % 64);
+    size_t len = strlen(symbol);
+    if ((word & mask) == mask) {
+        for (size_t i = buckets[h % nbuckets]; i >= symoffset && i < num_syms; i++) {
+            if (i - symoffset >= chain_len) {
+                break;
+            }
+            uint32_t ch = chain[i - symoffset];
+            if ((ch | 1) == (h | 1)
+                && __dynsym_matches(&syms[i], strtab, strtab_size, symbol, len, rule)) {
+                return 1;
+            }
+            if (ch & 1) {
+                break;
+            }
+        }
+    }
+    if (rule & EXEC_RULE_TYPED) {
+        for (size_t i = 1; i < symoffset && i < num_syms; i++) {
+            if (__dynsym_matches(&syms[i], strtab, strtab_size, symbol, len, rule)) {
+                return 1;
+            }
+        }
+    }
+    return -1;
+}
+
+/* SysV DT_HASH: bucket and chain arrays of symbol indexes. */
+static int __elf_sysv_hash_find(const struct ElfMap* map, const Elf64_Shdr* hash_hdr,
+                                const Elf64_Sym* syms, size_t num_syms, const char* strtab,
+                                size_t strtab_size, const char* symbol, unsigned int rule)
+{
+    const uint32_t* table = __elf_section_data(map, hash_hdr);
+    size_t words = hash_hdr->sh_size / sizeof(uint32_t);
+    if (!table || hash_hdr->sh_offset % sizeof(uint32_t) != 0 || words < 2
+        || (hash_hdr->sh_entsize != 0 && hash_hdr->sh_entsize != sizeof(uint32_t))) {
+        return -1;
+    }
+    uint32_t nbucket = table[0], nchain = table[1];
+    if (nbucket == 0 || (size_t)nbucket + nchain > words - 2) {
+        return -1;
+    }
+    const uint32_t* buckets = table + 2;
+    const uint32_t* chain = buckets + nbucket;
+
+    size_t len = strlen(symbol);
+    uint32_t i = buckets[__sysv_hash(symbol) % nbucket];
+    /* Bounded by nchain so a cyclic chain cannot loop forever. */
+    for (uint32_t steps = 0; i != STN_UNDEF && i < nchain && i < num_syms && steps < nchain;
+         steps++, i = chain[i]) {
+        if (__dynsym_matches(&syms[i], strtab, strtab_size, symbol, len, rule)) {
+            return 1;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Look the symbol up among the dynamic symbols, which stripped binaries
+ * keep. The binary's own .gnu.hash or SysV hash section is used when it
+ * has one, so only a few cache lines are touched; otherwise .dynsym is
+ * scanned.
+ */
+static int __elf_find_in_dynsym(const struct ElfMap* map, const char* symbol, unsigned int rule)
+{
+    size_t dynsym_index = 0;
+    const Elf64_Shdr* dynsym_hdr = NULL;
+    for (size_t i = 0; i < map->section_count; i++) {
+        if (map->sections[i].sh_type == SHT_DYNSYM) {
+            dynsym_index = i;
+            dynsym_hdr = &map->sections[i];
+            break;
+        }
+    }
+    if (!dynsym_hdr || dynsym_hdr->sh_link >= map->section_count
+        || dynsym_hdr->sh_entsize != sizeof(Elf64_Sym)
+        || dynsym_hdr->sh_offset % sizeof(uint64_t) != 0) {
+        return -1;
+    }
+    const Elf64_Shdr* strtab_hdr = &map->sections[dynsym_hdr->sh_link];
+    const Elf64_Sym* syms = __elf_section_data(map, dynsym_hdr);
+    const char* strtab = __elf_section_data(map, strtab_hdr);
+    if (!syms || !strtab) {
+        return -1;
+    }
+    size_t num_syms = dynsym_hdr->sh_size / sizeof(Elf64_Sym);
+
+    const Elf64_Shdr* gnu_hash = NULL;
+    const Elf64_Shdr* sysv_hash = NULL;
+    for (size_t i = 0; i < map->section_count; i++) {
+        if (map->sections[i].sh_link != dynsym_index) {
+            continue;
+        }
+        if (map->sections[i].sh_type == SHT_GNU_HASH) {
+            gnu_hash = &map->sections[i];
+        } else if (map->sections[i].sh_type == SHT_HASH) {
+            sysv_hash = &map->sections[i];
+        }
+    }
+    if (gnu_hash) {
+        return __elf_gnu_hash_find(map, gnu_hash, syms, num_syms, strtab, strtab_hdr->sh_size,
+                                   symbol, rule);
+    }
+    if (sysv_hash) {
+        return __elf_sysv_hash_find(map, sysv_hash, syms, num_syms, strtab, strtab_hdr->sh_size,
+                                    symbol, rule);
+    }
+    size_t len = strlen(symbol);
+    for (size_t i = 1; i < num_syms; i++) {
+        if (__dynsym_matches(&syms[i], strtab, strtab_hdr->sh_size, symbol, len, rule)) {
+            return 1;
+        }
+    }
+    return -1;
+}
+
+static char* __read_string_table(int fd, const Elf64_Shdr* shdr)
+{
+    if (shdr->sh_type == SHT_NOBITS || shdr->sh_size == 0 || shdr->sh_size > SSIZE_MAX) {
+        return NULL;
+    }
+    char* strtab = malloc(shdr->sh_size);
+    if (!strtab) {
+        return NULL;
+    }
+    
+    if (pread(fd, strtab, shdr->sh_size, shdr->sh_offset) != (ssize_t)shdr->sh_size) {
+        free(strtab);
+        return NULL;
+    }
+    
+    return strtab;
+}
+
+static int __read_exec_and_find_symbol(int fd, const char* symbol, unsigned int rule);
+static int __exec_cache_lookup(const struct ElfMap* map, int fd, const char* symbol,
+                               unsigned int rule);
+
+/*
+ * Look the symbol up in a mapping of the whole file: the hashed dynamic
+ * symbols first, then with EXEC_LOOKUP_SYMTAB .symtab: through the symbol
+ * index cache when one is set, by a scan otherwise. Descriptors that are
+ * not regular files or cannot be mapped only get the read() based
+ * .symtab scan.
+ */
+static int __parse_exec(int fd, const char* symbol, int flags)
+{
+    unsigned int rule = __exec_rule(flags);
+    struct ElfMap map;
+    int mapped = __elf_map(fd, &map);
+    if (mapped < 0) {
+        return flags & EXEC_LOOKUP_SYMTAB ? __read_exec_and_find_symbol(fd, symbol, rule) : -1;
+    }
+    if (mapped == 0) {
+        return -1;
+    }
+    int found = __elf_find_in_dynsym(&map, symbol, rule);
+    if (found < 0 && (flags & EXEC_LOOKUP_SYMTAB)) {
+        found = __exec_cache_lookup(&map, fd, symbol, rule);
+        found = found < 0 ? __elf_find_in_symtab(&map, symbol, rule) : found ? 1 : -1;
+    }
+    __elf_unmap(&map);
+    return found;
+}
+
+int find_symbol_in_executable(const char* filename, const char* symbol)
+{
+    return find_symbol_in_executable_ex(filename, symbol, EXEC_LOOKUP_SYMTAB);
+}
+
+int find_symbol_in_executable_ex(const char* filename, const char* symbol, int flags)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        return -1;
+    }
+    
+    Elf64_Ehdr header;
+    if (read(fd, &header, sizeof(header)) != sizeof(header)) {
+        close(fd);
+        return -1;
+    }
+    
+    /* verify file format */
+    if (memcmp(header.e_ident, ELFMAG, SELFMAG) != 0) {
+        close(fd);
+        return -1;
+    }
+    
+    /* File is valid, let's parse it and find the symbol. */
+    int result = __parse_exec(fd, symbol, flags);
+    close(fd);
+    return result;
+}
+
+int parse_exec_and_find_symbol(int fd, const char* symbol)
+{
+    return __parse_exec(fd, symbol, EXEC_LOOKUP_SYMTAB);
+}
+
+/*
+ * The same .symtab scan as __elf_find_in_symtab(), through pread() for
+ * descriptors that cannot be mapped, so both report the same symbols.
+ */
+static int __read_exec_and_find_symbol(int fd, const char* symbol, unsigned int rule)
+{
+    Elf64_Ehdr ehdr;
+    if (pread(fd, &ehdr, sizeof(ehdr), 0) != sizeof(ehdr)
+        || memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0
+        || ehdr.e_ident[EI_CLASS] != ELFCLASS64
+        || ehdr.e_shentsize != sizeof(Elf64_Shdr)) {
+        return -1;
+    }
+
+    /* Extended numbering keeps the real count in section 0. */
+    Elf64_Shdr first;
+    if (pread(fd, &first, sizeof(first), ehdr.e_shoff) != sizeof(first)) {
+        return -1;
+    }
+    size_t section_count = ehdr.e_shnum ? ehdr.e_shnum : first.sh_size;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)
+        && section_count > (uint64_t)st.st_size / sizeof(Elf64_Shdr)) {
+        return -1;
+    }
+    if (section_count > SSIZE_MAX / sizeof(Elf64_Shdr)) {
+        return -1;
+    }
+    
+    Elf64_Shdr* section_headers = malloc(sizeof(Elf64_Shdr) * section_count);
+    if (!section_headers) {
+        return -1;
+    }
+    ssize_t headers_size = sizeof(Elf64_Shdr) * section_count;
+    if (pread(fd, section_headers, headers_size, ehdr.e_shoff) != headers_size) {
+        free(section_headers);
+        return -1;
+    }
+    
+    /* The symbol table's string table is the one named by sh_link. */
+    const Elf64_Shdr* symtab_hdr = NULL;
+    for (size_t i = 0; i < section_count; i++) {
+        if (section_headers[i].sh_type == SHT_SYMTAB) {
+            symtab_hdr = &section_headers[i];
+            break;
+        }
+    }
+    if (!symtab_hdr || symtab_hdr->sh_link >= section_count
+        || symtab_hdr->sh_entsize != sizeof(Elf64_Sym)) {
+        free(section_headers);
+        return -1;
+    }
+    const Elf64_Shdr* strtab_hdr = &section_headers[symtab_hdr->sh_link];
+    char* strtab = __read_string_table(fd, strtab_hdr);
+    if (!strtab) {
+        free(section_headers);
+        return -1;
+    }
+    
+    int found = -1;
+    size_t len = strlen(symbol);
+    Elf64_Sym syms[64];
+    size_t batch_max = sizeof(syms) / sizeof(syms[0]);
+    size_t num_symbols = symtab_hdr->sh_size / sizeof(Elf64_Sym);
+    for (size_t i = 0; i < num_symbols && found < 0; ) {
+        size_t batch = num_symbols - i < batch_max ? num_symbols - i : batch_max;
+        ssize_t bytes = pread(fd, syms, batch * sizeof(Elf64_Sym),
+                              symtab_hdr->sh_offset + i * sizeof(Elf64_Sym));
+        if (bytes != (ssize_t)(batch * sizeof(Elf64_Sym))) {
+            break;
+        }
+        for (size_t j = 0; j < batch; j++) {
+            const Elf64_Sym* sym = &syms[j];
+            if (sym->st_name != 0 && (__elf_symbol_rules(sym) & rule)
+                && __elf_name_equals(strtab, strtab_hdr->sh_size, sym->st_name, symbol, len)) {
+                found = 1;
+                break;
+            }
+        }
+        i += batch;
+    }
+    
+    free(strtab);
+    free(section_headers);
+    return found;
+}
+
+/*
+ * Executable handles
+ */
+struct ExecSymbolEntry {
+    const Elf64_Sym* sym;
+    const char* name;
+    size_t length;
+    int dynamic;
+    int rank;           /* which of several same-named symbols wins */
+};
+
+struct ExecIndexSlot {
+    uint64_t hash;      /* 0: empty */
+    uint32_t entry;
+};
+
+struct ExecImage {
+    struct ElfMap map;
+    pthread_mutex_t index_lock;
+    atomic_int indexed;
+    struct ExecSymbolEntry* entries;
+    size_t entry_count;
+    struct ExecIndexSlot* slots;
+    size_t mask;
+    uint64_t seed;
+};
+
+/* Map an open ELF file into a new handle; the caller keeps the fd. */
+static ExecImage* __exec_image_map(int fd)
+{
+    ExecImage* image = calloc(1, sizeof(ExecImage));
+    if (!image || __elf_map(fd, &image->map) != 1) {
+        free(image);
+        return NULL;
+    }
+    pthread_mutex_init(&image->index_lock, NULL);
+    atomic_init(&image->indexed, 0);
+    return image;
+}
+
+ExecImage* exec_image_open(const char* filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+    ExecImage* image = __exec_image_map(fd);
+    close(fd);
+    return image;
+}
+
+static uint64_t __exec_hash(const ExecImage* image, const char* name, size_t length)
+{
+    uint64_t hash = lookup_hash64(name, length, image->seed);
+    return hash ? hash : 1;
+}
+
+/* Name of a symbol, or NULL if its offset or terminator is out of bounds. */
+static const char* __elf_symbol_name(const char* strtab, size_t strtab_size, Elf64_Word name,
+                                     size_t* length)
+{
+    if (name == 0 || name >= strtab_size) {
+        return NULL;
+    }
+    const char* end = memchr(strtab + name, '\0', strtab_size - name);
+    if (!end) {
+        return NULL;
+    }
+    *length = end - (strtab + name);
+    return strtab + name;
+}
+
+/* Symbol version table for the symbol table in section 'index', if any. */
+static const Elf64_Half* __elf_versym(const struct ElfMap* map, size_t index, size_t num_syms)
+{
+    for (size_t i = 0; i < map->section_count; i++) {
+        const Elf64_Shdr* hdr = &map->sections[i];
+        if (hdr->sh_type == SHT_GNU_versym && hdr->sh_link == index
+            && hdr->sh_size / sizeof(Elf64_Half) >= num_syms
+            && hdr->sh_offset % sizeof(Elf64_Half) == 0) {
+            return __elf_section_data(map, hdr);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Collect the defined symbols of one table into image->entries. Globals
+ * outrank locals, and a default symbol version outranks hidden ones
+ * (memcpy@@GLIBC_2.14 over memcpy@GLIBC_2.2.5).
+ */
+static int __exec_collect(ExecImage* image, unsigned int type, size_t* capacity)
+{
+    const struct ElfMap* map = &image->map;
+    for (size_t i = 0; i < map->section_count; i++) {
+        const Elf64_Shdr* hdr = &map->sections[i];
+        if (hdr->sh_type != type || hdr->sh_link >= map->section_count
+            || hdr->sh_entsize != sizeof(Elf64_Sym) || hdr->sh_offset % sizeof(uint64_t) != 0) {
+            continue;
+        }
+        const Elf64_Shdr* strtab_hdr = &map->sections[hdr->sh_link];
+        const Elf64_Sym* syms = __elf_section_data(map, hdr);
+        const char* strtab = __elf_section_data(map, strtab_hdr);
+        if (!syms || !strtab) {
+            continue;
+        }
+        size_t num_syms = hdr->sh_size / sizeof(Elf64_Sym);
+        const Elf64_Half* versym = type == SHT_DYNSYM ? __elf_versym(map, i, num_syms) : NULL;
+        for (size_t k = 1; k < num_syms; k++) {
+            if (!(__elf_symbol_rules(&syms[k]) & EXEC_RULE_DEFINED)) {
+                continue;
+            }
+            size_t length;
+            const char* name = __elf_symbol_name(strtab, strtab_hdr->sh_size, syms[k].st_name,
+                                                 &length);
+            if (!name) {
+                continue;
+            }
+            if (image->entry_count == *capacity) {
+                size_t grown = *capacity ? *capacity * 2 : 1024;
+                struct ExecSymbolEntry* entries = realloc(image->entries,
+                                                          sizeof(struct ExecSymbolEntry) * grown);
+                if (!entries) {
+                    return 0;
+                }
+                image->entries = entries;
+                *capacity = grown;
+            }
+            struct ExecSymbolEntry* entry = &image->entries[image->entry_count++];
+            entry->sym = &syms[k];
+            entry->name = name;
+            entry->length = length;
+            entry->dynamic = type == SHT_DYNSYM;
+            entry->rank = ELF64_ST_BIND(syms[k].st_info) == STB_LOCAL ? 0
+                          : versym && (versym[k] & 0x8000) ? 1 : 2;
+        }
+    }
+    return 1;
+}
+
+/* Probe for 'name'; returns its slot, empty if absent. */
+static struct ExecIndexSlot* __exec_probe(const ExecImage* image, const char* name,
+                                          size_t length, uint64_t hash)
+{
+    size_t pos = hash & image->mask;
+    for (;;) {
+        struct ExecIndexSlot* slot = &image->slots[pos];
+        if (!slot->hash) {
+            return slot;
+        }
+        const struct ExecSymbolEntry* entry = &image->entries[slot->entry];
+        if (slot->hash == hash && entry->length == length
+            && memcmp(entry->name, name, length) == 0) {
+            return slot;
+        }
+        pos = (pos + 1) & image->mask;
+    }
+}
+
+static int __exec_build_index(ExecImage* image)
+{
+    size_t capacity = 0;
+    if (!__exec_collect(image, SHT_DYNSYM, &capacity)
+        || !__exec_collect(image, SHT_SYMTAB, &capacity)) {
+        return 0;
+    }
+    size_t slots = 16;
+    while (slots < image->entry_count * 2) {
+        slots *= 2;
+    }
+    image->slots = calloc(slots, sizeof(struct ExecIndexSlot));
+    if (!image->slots) {
+        return 0;
+    }
+    image->mask = slots - 1;
+    image->seed = lookup_hash_seed();
+    for (size_t i = 0; i < image->entry_count; i++) {
+        const struct ExecSymbolEntry* entry = &image->entries[i];
+        uint64_t hash = __exec_hash(image, entry->name, entry->length);
+        struct ExecIndexSlot* slot = __exec_probe(image, entry->name, entry->length, hash);
+        if (!slot->hash) {
+            slot->hash = hash;
+            slot->entry = (uint32_t)i;
+        } else if (entry->rank > image->entries[slot->entry].rank) {
+            slot->entry = (uint32_t)i;
+        }
+    }
+    return 1;
+}
+
+static int __exec_ensure_index(ExecImage* image)
+{
+    int state = atomic_load_explicit(&image->indexed, memory_order_acquire);
+    if (state) {
+        return state > 0;
+    }
+    pthread_mutex_lock(&image->index_lock);
+    state = atomic_load_explicit(&image->indexed, memory_order_relaxed);
+    if (!state) {
+        state = __exec_build_index(image) ? 1 : -1;
+        atomic_store_explicit(&image->indexed, state, memory_order_release);
+    }
+    pthread_mutex_unlock(&image->index_lock);
+    return state > 0;
+}
+
+static void __exec_fill(const ExecImage* image, const struct ExecSymbolEntry* entry,
+                        ExecSymbol* out)
+{
+    const Elf64_Sym* sym = entry->sym;
+    out->name = entry->name;
+    out->value = sym->st_value;
+    out->size = sym->st_size;
+    out->type = ELF64_ST_TYPE(sym->st_info);
+    out->binding = ELF64_ST_BIND(sym->st_info);
+    out->section = sym->st_shndx;
+    out->section_name = NULL;
+    out->dynamic = entry->dynamic;
+
+    const struct ElfMap* map = &image->map;
+    if (sym->st_shndx < SHN_LORESERVE && sym->st_shndx < map->section_count
+        && map->shstrndx < map->section_count) {
+        const Elf64_Shdr* shstrtab_hdr = &map->sections[map->shstrndx];
+        const char* shstrtab = __elf_section_data(map, shstrtab_hdr);
+        size_t length;
+        if (shstrtab) {
+            out->section_name = __elf_symbol_name(shstrtab, shstrtab_hdr->sh_size,
+                                                  map->sections[sym->st_shndx].sh_name, &length);
+        }
+    }
+}
+
+int exec_image_find_symbol(ExecImage* image, const char* symbol, ExecSymbol* out)
+{
+    if (!__exec_ensure_index(image)) {
+        return -1;
+    }
+    size_t length = strlen(symbol);
+    const struct ExecIndexSlot* slot = __exec_probe(image, symbol, length,
+                                                    __exec_hash(image, symbol, length));
+    if (!slot->hash) {
+        return -1;
+    }
+    if (out) {
+        __exec_fill(image, &image->entries[slot->entry], out);
+    }
+    return 1;
+}
+
+/*
+ * Batched lookup: hash a group and prefetch every home slot before
+ * probing any, so the misses of independent names overlap.
+ */
+int exec_image_find_symbols_batch(ExecImage* image, const char** symbols, int count,
+                                  ExecSymbol* out, int* found)
+{
+    if (!__exec_ensure_index(image)) {
+        for (int i = 0; found && i < count; i++) {
+            found[i] = 0;
+        }
+        return 0;
+    }
+    uint64_t hashes[EXEC_BATCH];
+    size_t lengths[EXEC_BATCH];
+    int total = 0;
+    for (int base = 0; base < count; base += EXEC_BATCH) {
+        int group = count - base < EXEC_BATCH ? count - base : EXEC_BATCH;
+        for (int i = 0; i < group; i++) {
+            lengths[i] = strlen(symbols[base + i]);
+            hashes[i] = __exec_hash(image, symbols[base + i], lengths[i]);
+            EXEC_PREFETCH(&image->slots[hashes[i] & image->mask]);
+        }
+        for (int i = 0; i < group; i++) {
+            const struct ExecIndexSlot* slot = __exec_probe(image, symbols[base + i], lengths[i],
+                                                            hashes[i]);
+            int hit = slot->hash != 0;
+            if (hit && out) {
+                __exec_fill(image, &image->entries[slot->entry], &out[base + i]);
+            }
+            if (found) {
+                found[base + i] = hit;
+            }
+            total += hit;
+        }
+    }
+    return total;
+}
+
+void exec_image_close(ExecImage* image)
+{
+    __elf_unmap(&image->map);
+    pthread_mutex_destroy(&image->index_lock);
+    free(image->entries);
+    free(image->slots);
+    free(image);
+}
+
+/*
+ * Persistent symbol index cache
+ *
+ * The dynamic symbols already come with a hash table in the binary, so
+ * the cache stands in for the linear .symtab scan only. An index file
+ * lists every name that scan could accept, with the rules its entries
+ * satisfy: a header, a power-of-two array of linear-probing slots, then
+ * the names. It is written to a temporary
+ * file and renamed into place, so readers never see a partial index, and
+ * checked against its key on every open.
+ */
+#define EXEC_CACHE_MAGIC      "LKSYMIX1"
+#define EXEC_CACHE_BUILD_ID   64            /* longest build-id used as a key */
+
+struct ExecCacheKey {
+    uint64_t build_id_length;
+    unsigned char build_id[EXEC_CACHE_BUILD_ID];
+    uint64_t dev;           /* file identity, zero when keyed by build-id */
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t symtab_size;   /* copies changed by strip or objcopy share the build-id */
+};
+
+struct ExecCacheHeader {
+    char magic[8];
+    struct ExecCacheKey key;
+    uint64_t seed;
+    uint64_t slot_count;
+    uint64_t names_size;
+};
+
+struct ExecCacheSlot {
+    uint64_t hash;          /* 0: empty */
+    uint32_t name;          /* offset into the names */
+    uint32_t length;
+    uint64_t rules;         /* EXEC_RULE_ bits of the entries with this name */
+};
+
+struct ExecCacheBuild {
+    struct ExecCacheHeader header;
+    struct ExecCacheSlot* slots;
+    char* names;
+    size_t names_capacity;
+};
+
+/*
+ * Once an index cannot be stored for lack of permission (EACCES, EPERM or
+ * EROFS), the directory is treated as read-only: existing indexes are
+ * still used, but a miss scans .symtab instead of building an index that
+ * would only be thrown away. Other failures, such as running out of
+ * descriptors or space, only cost the index at hand. Setting the directory
+ * again clears this; 'exec_cache_generation' keeps a late failure from
+ * marking a newly set directory.
+ */
+static pthread_mutex_t exec_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static char* exec_cache_dir;
+static int exec_cache_readonly;
+static unsigned long exec_cache_generation;
+
+int exec_lookup_set_cache_dir(const char* dir)
+{
+    char* copy = NULL;
+    if (dir) {
+        struct stat st;
+        if (stat(dir, &st) != 0 || !S_ISDIR(st.st_mode) || !(copy = strdup(dir))) {
+            return -1;
+        }
+    }
+    pthread_mutex_lock(&exec_cache_lock);
+    free(exec_cache_dir);
+    exec_cache_dir = copy;
+    exec_cache_readonly = 0;
+    exec_cache_generation++;
+    pthread_mutex_unlock(&exec_cache_lock);
+    return 1;
+}
+
+/* First symbol table of 'type' that passes the checks the lookups make. */
+static const Elf64_Shdr* __elf_first_table(const struct ElfMap* map, unsigned int type,
+                                           const Elf64_Sym** syms, const char** strtab)
 {
-    char* strtab = malloc(shdr->sh_size);
-    if (!strtab) {
-        return NULL;
+    for (size_t i = 0; i < map->section_count; i++) {
+        const Elf64_Shdr* hdr = &map->sections[i];
+        if (hdr->sh_type != type) {
+            continue;
+        }
+        if (hdr->sh_link >= map->section_count || hdr->sh_entsize != sizeof(Elf64_Sym)
+            || hdr->sh_offset % sizeof(uint64_t) != 0) {
+            return NULL;
+        }
+        *syms = __elf_section_data(map, hdr);
+        *strtab = __elf_section_data(map, &map->sections[hdr->sh_link]);
+        return *syms && *strtab ? hdr : NULL;
     }
-    
-    if (lseek(fd, shdr->sh_offset, SEEK_SET) == -1) {
-        free(strtab);
-        return NULL;
+    return NULL;
+}
+
+/* The NT_GNU_BUILD_ID note's descriptor, or 0 if there is none. */
+static size_t __elf_build_id(const struct ElfMap* map, const unsigned char** id)
+{
+    for (size_t i = 0; i < map->section_count; i++) {
+        const Elf64_Shdr* hdr = &map->sections[i];
+        const unsigned char* notes = hdr->sh_type == SHT_NOTE ? __elf_section_data(map, hdr)
+                                                              : NULL;
+        if (!notes) {
+            continue;
+        }
+        size_t align = hdr->sh_addralign == 8 ? 8 : 4;
+        size_t offset = 0;
+        while (hdr->sh_size - offset >= sizeof(Elf64_Nhdr)) {
+            Elf64_Nhdr note;
+            memcpy(&note, notes + offset, sizeof(note));
+            offset += sizeof(note);
+            size_t name_size = ((size_t)note.n_namesz + align - 1) & ~(align - 1);
+            size_t desc_size = ((size_t)note.n_descsz + align - 1) & ~(align - 1);
+            if (name_size > hdr->sh_size - offset
+                || desc_size > hdr->sh_size - offset - name_size) {
+                break;
+            }
+            if (note.n_type == NT_GNU_BUILD_ID && note.n_namesz == sizeof(ELF_NOTE_GNU)
+                && memcmp(notes + offset, ELF_NOTE_GNU, sizeof(ELF_NOTE_GNU)) == 0
+                && note.n_descsz > 0 && note.n_descsz <= EXEC_CACHE_BUILD_ID) {
+                *id = notes + offset + name_size;
+                return note.n_descsz;
+            }
+            offset += name_size + desc_size;
+        }
     }
-    
-    if (read(fd, strtab, shdr->sh_size) != shdr->sh_size) {
-        free(strtab);
-        return NULL;
+    return 0;
+}
+
+/* Fill in the key of a binary and the file name of its index. */
+static int __exec_cache_key(const struct ElfMap* map, const Elf64_Shdr* symtab, int fd,
+                            struct ExecCacheKey* key, char* name, size_t name_size)
+{
+    memset(key, 0, sizeof(*key));
+    key->symtab_size = symtab->sh_size;
+
+    const unsigned char* id;
+    size_t id_length = __elf_build_id(map, &id);
+    if (id_length > 0) {
+        key->build_id_length = id_length;
+        memcpy(key->build_id, id, id_length);
+        char hex[EXEC_CACHE_BUILD_ID * 2 + 1];
+        for (size_t i = 0; i < id_length; i++) {
+            sprintf(hex + i * 2, "%02x", id[i]);
+        }
+        return snprintf(name, name_size, "%s-%llx.symidx", hex,
+                        (unsigned long long)key->symtab_size) < (int)name_size;
     }
-    
-    return strtab;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return 0;
+    }
+    key->dev = st.st_dev;
+    key->ino = st.st_ino;
+    key->size = st.st_size;
+    key->mtime_sec = st.st_mtim.tv_sec;
+    key->mtime_nsec = st.st_mtim.tv_nsec;
+    return snprintf(name, name_size, "i-%llx-%llx.symidx", (unsigned long long)key->dev,
+                    (unsigned long long)key->ino) < (int)name_size;
 }
 
-int find_symbol_in_executable(const char* filename, const char* symbol)
+static uint64_t __exec_cache_hash(const struct ExecCacheHeader* header, const char* name,
+                                  size_t length)
 {
-    int fd = open(filename, O_RDONLY);
+    uint64_t hash = lookup_hash64(name, length, header->seed);
+    return hash ? hash : 1;
+}
+
+/* Slot holding 'name', or the empty slot where it belongs; NULL if full. */
+static struct ExecCacheSlot* __exec_cache_probe(const struct ExecCacheHeader* header,
+                                                const struct ExecCacheSlot* slots,
+                                                const char* names, const char* name,
+                                                size_t length, uint64_t hash)
+{
+    size_t mask = header->slot_count - 1;
+    size_t pos = hash & mask;
+    for (size_t steps = 0; steps < header->slot_count; steps++, pos = (pos + 1) & mask) {
+        const struct ExecCacheSlot* slot = &slots[pos];
+        if (!slot->hash) {
+            return (struct ExecCacheSlot*)slot;
+        }
+        if (slot->hash == hash && slot->length == length
+            && slot->name <= header->names_size && length <= header->names_size - slot->name
+            && memcmp(names + slot->name, name, length) == 0) {
+            return (struct ExecCacheSlot*)slot;
+        }
+    }
+    return NULL;
+}
+
+static int __exec_cache_find(const struct ExecCacheHeader* header,
+                             const struct ExecCacheSlot* slots, const char* names,
+                             const char* symbol, unsigned int rule)
+{
+    size_t length = strlen(symbol);
+    const struct ExecCacheSlot* slot = __exec_cache_probe(header, slots, names, symbol, length,
+                                                          __exec_cache_hash(header, symbol,
+                                                                            length));
+    return slot && slot->hash && (slot->rules & rule);
+}
+
+static int __exec_cache_add(struct ExecCacheBuild* build, const char* name, size_t length,
+                            unsigned int rules)
+{
+    struct ExecCacheHeader* header = &build->header;
+    uint64_t hash = __exec_cache_hash(header, name, length);
+    struct ExecCacheSlot* slot = __exec_cache_probe(header, build->slots, build->names, name,
+                                                    length, hash);
+    if (!slot) {
+        return 0;
+    }
+    if (slot->hash) {
+        slot->rules |= rules;
+        return 1;
+    }
+    if (build->names_capacity - header->names_size < length + 1) {
+        size_t grown = build->names_capacity * 2 + length + 1;
+        char* names = realloc(build->names, grown);
+        if (!names) {
+            return 0;
+        }
+        build->names = names;
+        build->names_capacity = grown;
+    }
+    slot->hash = hash;
+    slot->name = (uint32_t)header->names_size;
+    slot->length = (uint32_t)length;
+    slot->rules = rules;
+    memcpy(build->names + header->names_size, name, length + 1);
+    header->names_size += length + 1;
+    return 1;
+}
+
+/* Index the .symtab names that __elf_find_in_symtab() accepts under any rule. */
+static int __exec_cache_build(const struct ElfMap* map, const Elf64_Shdr* symtab,
+                              const Elf64_Sym* syms, const char* strtab,
+                              const struct ExecCacheKey* key, struct ExecCacheBuild* build)
+{
+    size_t num_syms = symtab->sh_size / sizeof(Elf64_Sym);
+    size_t strtab_size = map->sections[symtab->sh_link].sh_size;
+    memset(build, 0, sizeof(*build));
+    memcpy(build->header.magic, EXEC_CACHE_MAGIC, sizeof(build->header.magic));
+    build->header.key = *key;
+    build->header.seed = lookup_hash_seed();
+    build->header.slot_count = 16;
+    while (build->header.slot_count < num_syms * 2) {
+        build->header.slot_count *= 2;
+    }
+    build->slots = calloc(build->header.slot_count, sizeof(struct ExecCacheSlot));
+    if (!build->slots) {
+        return 0;
+    }
+
+#ifdef MADV_SEQUENTIAL
+    __elf_advise(map, symtab, MADV_SEQUENTIAL);
+#endif
+    int ok = 1;
+    for (size_t i = 0; ok && i < num_syms; i++) {
+        size_t length;
+        const char* name = __elf_symbol_name(strtab, strtab_size, syms[i].st_name, &length);
+        unsigned int rules = __elf_symbol_rules(&syms[i]);
+        if (name && rules) {
+            ok = length <= UINT32_MAX && __exec_cache_add(build, name, length, rules);
+        }
+    }
+    if (!ok || build->header.names_size > UINT32_MAX) {
+        free(build->slots);
+        free(build->names);
+        return 0;
+    }
+    return 1;
+}
+
+static int __write_all(int fd, const void* data, size_t size)
+{
+    const char* p = data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n <= 0) {
+            return 0;
+        }
+        p += n;
+        size -= n;
+    }
+    return 1;
+}
+
+/*
+ * Create a unique temporary file 'tmp' next to 'path'. Unlike mkstemp(),
+ * which always creates mode 0600, this passes 0666 to open() so the index
+ * gets the caller's umask like any other file it creates.
+ */
+static int __exec_cache_temp(const char* path, char* tmp, size_t tmp_size)
+{
+    static atomic_uint counter;
+    for (int attempt = 0; attempt < 100; attempt++) {
+        if (snprintf(tmp, tmp_size, "%s.%ld.%u", path, (long)getpid(),
+                     atomic_fetch_add(&counter, 1)) >= (int)tmp_size) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        int fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (fd != -1 || errno != EEXIST) {
+            return fd;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Write the index to the temporary file 'tmp', flush it to disk and rename
+ * it to 'path', so a crash cannot leave an empty or torn index behind. On
+ * failure errno tells why.
+ */
+static int __exec_cache_store(int fd, const char* tmp, const char* path,
+                              const struct ExecCacheBuild* build)
+{
+    int ok = __write_all(fd, &build->header, sizeof(build->header))
+             && __write_all(fd, build->slots,
+                            sizeof(struct ExecCacheSlot) * build->header.slot_count)
+             && __write_all(fd, build->names, build->header.names_size)
+             && fsync(fd) == 0;
+    int error = errno;
+    if (close(fd) != 0 && ok) {
+        ok = 0;
+        error = errno;
+    }
+    if (ok && rename(tmp, path) != 0) {
+        ok = 0;
+        error = errno;
+    }
+    if (!ok) {
+        unlink(tmp);
+        errno = error;
+    }
+    return ok;
+}
+
+/* Treat the directory as read-only if 'error' says it cannot be written. */
+static void __exec_cache_mark_readonly(unsigned long generation, int error)
+{
+    if (error != EACCES && error != EPERM && error != EROFS) {
+        return;
+    }
+    pthread_mutex_lock(&exec_cache_lock);
+    if (generation == exec_cache_generation) {
+        exec_cache_readonly = 1;
+    }
+    pthread_mutex_unlock(&exec_cache_lock);
+}
+
+/* Answer from an existing index: 1 or 0, -1 if it is missing or stale. */
+static int __exec_cache_read(const char* path, const struct ExecCacheKey* key,
+                             const char* symbol, unsigned int rule)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
     if (fd == -1) {
         return -1;
     }
-    
-    Elf64_Ehdr header;
-    if (read(fd, &header, sizeof(header)) != sizeof(header)) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct ExecCacheHeader)) {
         close(fd);
         return -1;
     }
-    
-    /* verify file format */
-    if (memcmp(header.e_ident, ELFMAG, SELFMAG) != 0) {
-        close(fd);
+    size_t size = st.st_size;
+    void* base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
         return -1;
     }
-    
-    /* File is valid, let's parse it and find the symbol. */
-    int result = parse_exec_and_find_symbol(fd, symbol);
-    close(fd);
-    return result;
+    const struct ExecCacheHeader* header = base;
+    size_t room = (size - sizeof(*header)) / sizeof(struct ExecCacheSlot);
+    int found = -1;
+    if (memcmp(header->magic, EXEC_CACHE_MAGIC, sizeof(header->magic)) == 0
+        && memcmp(&header->key, key, sizeof(*key)) == 0
+        && header->slot_count > 0 && (header->slot_count & (header->slot_count - 1)) == 0
+        && header->slot_count <= room
+        && header->names_size == size - sizeof(*header)
+                                 - sizeof(struct ExecCacheSlot) * header->slot_count) {
+        const struct ExecCacheSlot* slots = (const struct ExecCacheSlot*)(header + 1);
+        found = __exec_cache_find(header, slots, (const char*)(slots + header->slot_count),
+                                  symbol, rule);
+    }
+    munmap(base, size);
+    return found;
 }
 
-int parse_exec_and_find_symbol(int fd, const char* symbol)
+/*
+ * Look 'symbol' up in .symtab through the cache: 1 or 0 from a valid
+ * index, built and stored first if need be; -1 with no cache directory,
+ * no usable .symtab or on failure.
+ */
+static int __exec_cache_lookup(const struct ElfMap* map, int fd, const char* symbol,
+                               unsigned int rule)
 {
-    Elf64_Ehdr ehdr;
-    
-    /* Go back to start of file. */
-    if (lseek(fd, 0, SEEK_SET) == -1) {
+    const Elf64_Sym* syms;
+    const char* strtab;
+    const Elf64_Shdr* symtab = __elf_first_table(map, SHT_SYMTAB, &syms, &strtab);
+    if (!symtab) {
         return -1;
     }
-    
-    /* Read ELF header and section headers. */
-    if (read(fd, &ehdr, sizeof(ehdr)) != sizeof(ehdr)) {
-        return -1;
+    char path[PATH_MAX];
+    int enabled = 0;
+    int readonly = 0;
+    unsigned long generation = 0;
+    pthread_mutex_lock(&exec_cache_lock);
+    if (exec_cache_dir) {
+        enabled = snprintf(path, sizeof(path), "%s/", exec_cache_dir) < (int)sizeof(path);
+        readonly = exec_cache_readonly;
+        generation = exec_cache_generation;
     }
-    
-    Elf64_Shdr* section_headers = malloc(sizeof(Elf64_Shdr) * ehdr.e_shnum);
-    if (!section_headers) {
+    pthread_mutex_unlock(&exec_cache_lock);
+    if (!enabled) {
         return -1;
     }
-    if (lseek(fd, ehdr.e_shoff, SEEK_SET) == -1) {
-        free(section_headers);
+    struct ExecCacheKey key;
+    size_t dir_length = strlen(path);
+    if (!__exec_cache_key(map, symtab, fd, &key, path + dir_length, sizeof(path) - dir_length)) {
         return -1;
     }
-    if (read(fd, section_headers, sizeof(Elf64_Shdr) * ehdr.e_shnum)
-        != sizeof(Elf64_Shdr) * ehdr.e_shnum) {
-        free(section_headers);
+    int found = __exec_cache_read(path, &key, symbol, rule);
+    if (found >= 0 || readonly) {
+        return found;
+    }
+
+    /* Make sure the index can be stored before paying for building it. */
+    char tmp[PATH_MAX];
+    int tmp_fd = __exec_cache_temp(path, tmp, sizeof(tmp));
+    if (tmp_fd == -1) {
+        __exec_cache_mark_readonly(generation, errno);
         return -1;
     }
-    
-    /* Retrieve section header string table. */
-    Elf64_Shdr* sh_strtab = &section_headers[ehdr.e_shstrndx];
-    char* sh_strtab_data = __read_string_table(fd, sh_strtab);
-    if (!sh_strtab_data) {
-        free(section_headers);
+    struct ExecCacheBuild build;
+    if (!__exec_cache_build(map, symtab, syms, strtab, &key, &build)) {
+        close(tmp_fd);
+        unlink(tmp);
         return -1;
     }
-    
-    /* Retrieve the symbol table and its associated string table. */
-    Elf64_Shdr* symtab_hdr = NULL;
-    Elf64_Shdr* strtab_hdr = NULL;
-    
-    for (int i = 0; i < ehdr.e_shnum; i++) {
-        const char* section_name = sh_strtab_data + section_headers[i].sh_name;
-        
-        if (section_headers[i].sh_type == SHT_SYMTAB) {
-            symtab_hdr = &section_headers[i];
-        } else if (strcmp(section_name, ".strtab") == 0) {
-            strtab_hdr = &section_headers[i];
-        }
+    found = __exec_cache_find(&build.header, build.slots, build.names, symbol, rule);
+    if (!__exec_cache_store(tmp_fd, tmp, path, &build)) {
+        __exec_cache_mark_readonly(generation, errno);
     }
-    
-    if (!symtab_hdr || !strtab_hdr) {
-        free(sh_strtab_data);
-        free(section_headers);
+    free(build.slots);
+    free(build.names);
+    return found;
+}
+
+/*
+ * Bulk scans
+ *
+ * The calling thread walks the paths and feeds a queue that the workers
+ * drain. With EXEC_SCAN_PREFETCH it also opens each file and starts
+ * readahead before queueing it. A file counts as in flight from the
+ * moment the walker reserves room for it, before opening it, until a
+ * worker is done with it, so 'capacity' bounds queued files, open
+ * descriptors and outstanding readahead together.
+ */
+#define EXEC_SCAN_HEAD        (256 * 1024)  /* prefetched from the start of a file */
+
+struct ExecScanItem {
+    char* path;
+    int fd;             /* -1: not opened yet */
+};
+
+struct ExecScan {
+    const char** symbols;
+    int count;
+    int flags;
+    ExecScanFunc on_file;
+    void* ctx;
+
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    struct ExecScanItem* queue;
+    size_t capacity;    /* files in flight at most */
+    size_t inflight;
+    size_t head;
+    size_t queued;
+    int closed;         /* nothing more will be queued */
+
+    pthread_mutex_t report_lock;
+    atomic_int stopped;
+    long reported;
+};
+
+struct ExecScanWorker {
+    pthread_t thread;
+    struct ExecScan* scan;
+    int* found;         /* 'count' results */
+};
+
+/* Open 'path' if it is a regular 64-bit ELF file; returns the fd or -1. */
+static int __scan_open(const char* path, int flags)
+{
+    /* O_NONBLOCK keeps a FIFO in the path list from stalling the scan. */
+    int fd = open(path, O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+    if (fd == -1) {
         return -1;
     }
-    
-    /* We have the tables, let's read and process 'em. */
-    char* strtab = __read_string_table(fd, strtab_hdr);
-    if (!strtab) {
-        free(sh_strtab_data);
-        free(section_headers);
+    struct stat st;
+    Elf64_Ehdr ehdr;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)
+        || pread(fd, &ehdr, sizeof(ehdr), 0) != sizeof(ehdr)
+        || memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0
+        || ehdr.e_ident[EI_CLASS] != ELFCLASS64) {
+        close(fd);
         return -1;
     }
+    if (flags & EXEC_SCAN_PREFETCH) {
+        if (flags & EXEC_SCAN_SYMTAB) {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        } else {
+            /* Headers, .dynsym, .dynstr and the hash table sit near the start. */
+            posix_fadvise(fd, 0, EXEC_SCAN_HEAD, POSIX_FADV_WILLNEED);
+            posix_fadvise(fd, ehdr.e_shoff, (off_t)ehdr.e_shnum * sizeof(Elf64_Shdr),
+                          POSIX_FADV_WILLNEED);
+        }
+    }
+    return fd;
+}
 
-    if (lseek(fd, symtab_hdr->sh_offset, SEEK_SET) == -1) {
-        free(strtab);
-        free(sh_strtab_data);
-        free(section_headers);
-        return -1;
+/* A file is no longer in flight. */
+static void __scan_release(struct ExecScan* scan)
+{
+    pthread_mutex_lock(&scan->lock);
+    scan->inflight--;
+    pthread_cond_signal(&scan->not_full);
+    pthread_mutex_unlock(&scan->lock);
+}
+
+/* Queue a file, taking ownership of 'path'. */
+static void __scan_push(struct ExecScan* scan, char* path)
+{
+    pthread_mutex_lock(&scan->lock);
+    while (scan->inflight == scan->capacity) {
+        pthread_cond_wait(&scan->not_full, &scan->lock);
     }
-    
-    int found = -1;
-    Elf64_Sym sym;
-    size_t num_symbols = symtab_hdr->sh_size / sizeof(Elf64_Sym);
-    
-    for (size_t i = 0; i < num_symbols; i++) {
-        if (read(fd, &sym, sizeof(sym)) != sizeof(sym)) {
-            break;
+    scan->inflight++;
+    pthread_mutex_unlock(&scan->lock);
+
+    int fd = -1;
+    if (scan->flags & EXEC_SCAN_PREFETCH) {
+        fd = __scan_open(path, scan->flags);
+        if (fd == -1) {
+            __scan_release(scan);
+            free(path);
+            return;
         }
-        
-        /* Filter out empty symbols */
-        if (sym.st_name == 0) {
+    }
+    pthread_mutex_lock(&scan->lock);
+    struct ExecScanItem* item = &scan->queue[(scan->head + scan->queued) % scan->capacity];
+    item->path = path;
+    item->fd = fd;
+    scan->queued++;
+    pthread_cond_signal(&scan->not_empty);
+    pthread_mutex_unlock(&scan->lock);
+}
+
+static int __scan_pop(struct ExecScan* scan, struct ExecScanItem* item)
+{
+    pthread_mutex_lock(&scan->lock);
+    while (scan->queued == 0 && !scan->closed) {
+        pthread_cond_wait(&scan->not_empty, &scan->lock);
+    }
+    if (scan->queued == 0) {
+        pthread_mutex_unlock(&scan->lock);
+        return 0;
+    }
+    *item = scan->queue[scan->head];
+    scan->head = (scan->head + 1) % scan->capacity;
+    scan->queued--;
+    pthread_mutex_unlock(&scan->lock);
+    return 1;
+}
+
+static void __scan_file(struct ExecScan* scan, const struct ExecScanItem* item, int* found)
+{
+    int fd = item->fd != -1 ? item->fd : __scan_open(item->path, 0);
+    if (fd == -1) {
+        return;
+    }
+    int mapped = 0;
+    if (scan->flags & EXEC_SCAN_SYMTAB) {
+        /* One index over every symbol beats a .symtab pass per name. */
+        ExecImage* image = __exec_image_map(fd);
+        if (image) {
+            exec_image_find_symbols_batch(image, scan->symbols, scan->count, NULL, found);
+            exec_image_close(image);
+            mapped = 1;
+        }
+    } else {
+        struct ElfMap map;
+        if (__elf_map(fd, &map) == 1) {
+            for (int i = 0; i < scan->count; i++) {
+                found[i] = __elf_find_in_dynsym(&map, scan->symbols[i], EXEC_RULE_DEFINED) == 1;
+            }
+            __elf_unmap(&map);
+            mapped = 1;
+        }
+    }
+    close(fd);
+    if (!mapped) {
+        return;
+    }
+
+    pthread_mutex_lock(&scan->report_lock);
+    if (!atomic_load(&scan->stopped)) {
+        scan->reported++;
+        if (scan->on_file(item->path, found, scan->count, scan->ctx) != 0) {
+            atomic_store(&scan->stopped, 1);
+        }
+    }
+    pthread_mutex_unlock(&scan->report_lock);
+}
+
+static void* __scan_worker(void* arg)
+{
+    struct ExecScanWorker* worker = arg;
+    struct ExecScan* scan = worker->scan;
+    struct ExecScanItem item;
+    while (__scan_pop(scan, &item)) {
+        if (!atomic_load(&scan->stopped)) {
+            __scan_file(scan, &item, worker->found);
+        } else if (item.fd != -1) {
+            close(item.fd);
+        }
+        free(item.path);
+        __scan_release(scan);
+    }
+    return NULL;
+}
+
+/* Push a directory path onto the walk's stack, taking ownership of it. */
+static int __scan_stack_push(char*** stack, size_t* depth, size_t* capacity, char* path)
+{
+    if (*depth == *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 16;
+        char** bigger = realloc(*stack, sizeof(char*) * grown);
+        if (!bigger) {
+            free(path);
+            return 0;
+        }
+        *stack = bigger;
+        *capacity = grown;
+    }
+    (*stack)[(*depth)++] = path;
+    return 1;
+}
+
+/*
+ * Queue every regular file below 'root' without following symbolic links.
+ * Directories waiting to be read are kept on a heap stack of paths and
+ * read one at a time, so the walk holds a single directory descriptor
+ * however deep the tree is.
+ */
+static void __scan_walk(struct ExecScan* scan, const char* root)
+{
+    char** stack = NULL;
+    size_t depth = 0, capacity = 0;
+    char* first = strdup(root);
+    if (!first || !__scan_stack_push(&stack, &depth, &capacity, first)) {
+        return;
+    }
+    while (depth > 0) {
+        char* dir = stack[--depth];
+        DIR* d = atomic_load(&scan->stopped) ? NULL : opendir(dir);
+        if (!d) {
+            free(dir);
             continue;
         }
-        
-        const char* sym_name = strtab + sym.st_name;
-        if (strcmp(sym_name, symbol) == 0) {
-            /* Check if the symbol we have is valid */
-            unsigned char type = ELF64_ST_TYPE(sym.st_info);
-            if (type == STT_FUNC || type == STT_OBJECT) {
-                found = 1;
+        size_t dir_len = strlen(dir);
+        int slash = dir_len > 0 && dir[dir_len - 1] != '/';
+        struct dirent* ent;
+        while (!atomic_load(&scan->stopped) && (ent = readdir(d))) {
+            if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+                continue;
+            }
+            size_t name_len = strlen(ent->d_name);
+            char* path = malloc(dir_len + slash + name_len + 1);
+            if (!path) {
                 break;
             }
+            memcpy(path, dir, dir_len);
+            if (slash) {
+                path[dir_len] = '/';
+            }
+            memcpy(path + dir_len + slash, ent->d_name, name_len + 1);
+
+            unsigned char type = ent->d_type;
+            struct stat st;
+            if (type == DT_UNKNOWN && lstat(path, &st) == 0) {
+                type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+            }
+            if (type == DT_REG) {
+                __scan_push(scan, path);
+            } else if (type == DT_DIR) {
+                __scan_stack_push(&stack, &depth, &capacity, path);
+            } else {
+                free(path);
+            }
         }
+        closedir(d);
+        free(dir);
     }
-    
-    free(strtab);
-    free(sh_strtab_data);
-    free(section_headers);
-    return found;
+    free(stack);
+}
+
+static long __exec_scan(const char** paths, size_t path_count, const char* root,
+                        const char** symbols, int count, const ExecScanOptions* options,
+                        ExecScanFunc on_file, void* ctx)
+{
+    if (count < 0 || !on_file) {
+        return -1;
+    }
+    int threads = options ? options->threads : 0;
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    size_t max_inflight = options && options->max_inflight > 0
+                          ? (size_t)options->max_inflight : (size_t)threads * 4;
+
+    struct ExecScan scan = { .symbols = symbols, .count = count, .on_file = on_file,
+                             .ctx = ctx, .capacity = max_inflight };
+    scan.flags = options ? options->flags : 0;
+    scan.queue = malloc(sizeof(struct ExecScanItem) * max_inflight);
+    struct ExecScanWorker* workers = malloc(sizeof(struct ExecScanWorker) * threads);
+    int* found = malloc(sizeof(int) * ((size_t)threads * count + 1));
+    if (!scan.queue || !workers || !found) {
+        free(scan.queue);
+        free(workers);
+        free(found);
+        return -1;
+    }
+    pthread_mutex_init(&scan.lock, NULL);
+    pthread_cond_init(&scan.not_empty, NULL);
+    pthread_cond_init(&scan.not_full, NULL);
+    pthread_mutex_init(&scan.report_lock, NULL);
+    atomic_init(&scan.stopped, 0);
+
+    int started = 0;
+    for (int i = 0; i < threads; i++) {
+        workers[started].scan = &scan;
+        workers[started].found = found + (size_t)started * count;
+        if (pthread_create(&workers[started].thread, NULL, __scan_worker,
+                           &workers[started]) == 0) {
+            started++;
+        }
+    }
+    if (started > 0) {
+        struct stat st;
+        if (root && lstat(root, &st) == 0) {
+            if (S_ISDIR(st.st_mode)) {
+                __scan_walk(&scan, root);
+            } else if (S_ISREG(st.st_mode)) {
+                char* path = strdup(root);
+                if (path) {
+                    __scan_push(&scan, path);
+                }
+            }
+        }
+        for (size_t i = 0; i < path_count && !atomic_load(&scan.stopped); i++) {
+            char* path = strdup(paths[i]);
+            if (path) {
+                __scan_push(&scan, path);
+            }
+        }
+    }
+    pthread_mutex_lock(&scan.lock);
+    scan.closed = 1;
+    pthread_cond_broadcast(&scan.not_empty);
+    pthread_mutex_unlock(&scan.lock);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    pthread_mutex_destroy(&scan.lock);
+    pthread_cond_destroy(&scan.not_empty);
+    pthread_cond_destroy(&scan.not_full);
+    pthread_mutex_destroy(&scan.report_lock);
+    free(scan.queue);
+    free(workers);
+    free(found);
+    return started > 0 ? scan.reported : -1;
+}
+
+long exec_scan_files(const char** paths, size_t path_count, const char** symbols, int count,
+                     const ExecScanOptions* options, ExecScanFunc on_file, void* ctx)
+{
+    return __exec_scan(paths, path_count, NULL, symbols, count, options, on_file, ctx);
+}
+
+long exec_scan_tree(const char* root, const char** symbols, int count,
+                    const ExecScanOptions* options, ExecScanFunc on_file, void* ctx)
+{
+    return __exec_scan(NULL, 0, root, symbols, count, options, on_file, ctx);
 }
 #endif  /* PLATFORM_ELF */
 
 /* macOS (Mach-O format) */
 #ifdef PLATFORM_MACHO
+int find_symbol_in_executable_ex(const char *filename, const char *symbol, int flags)
+{
+   (void)flags;  /* Mach-O has a single symbol table */
+   return find_symbol_in_executable(filename, symbol);
+}
+
 int find_symbol_in_executable(const char *filename, const char *symbol)
 {
    int fd = open(filename, O_RDONLY);
@@ -269,5 +1748,70 @@ int parse_exec_and_find_symbol(int fd, const char *symbol)
 
    return -1;  /* Unable to find the symbol. */
 }
+
+/* The symbol index cache is only implemented for ELF. */
+int exec_lookup_set_cache_dir(const char *dir)
+{
+   (void)dir;
+   return -1;
+}
+
+/* Executable handles are only implemented for ELF. */
+ExecImage* exec_image_open(const char *filename)
+{
+   (void)filename;
+   return NULL;
+}
+
+int exec_image_find_symbol(ExecImage *image, const char *symbol, ExecSymbol *out)
+{
+   (void)image;
+   (void)symbol;
+   (void)out;
+   return -1;
+}
+
+int exec_image_find_symbols_batch(ExecImage *image, const char **symbols, int count,
+                                  ExecSymbol *out, int *found)
+{
+   (void)image;
+   (void)symbols;
+   (void)out;
+   for (int i = 0; found && i < count; i++) {
+       found[i] = 0;
+   }
+   return 0;
+}
+
+void exec_image_close(ExecImage *image)
+{
+   (void)image;
+}
+
+/* Bulk scans are only implemented for ELF. */
+long exec_scan_files(const char **paths, size_t path_count, const char **symbols, int count,
+                     const ExecScanOptions *options, ExecScanFunc on_file, void *ctx)
+{
+   (void)paths;
+   (void)path_count;
+   (void)symbols;
+   (void)count;
+   (void)options;
+   (void)on_file;
+   (void)ctx;
+   return -1;
+}
+
+long exec_scan_tree(const char *root, const char **symbols, int count,
+                    const ExecScanOptions *options, ExecScanFunc on_file, void *ctx)
+{
+   (void)root;
+   (void)symbols;
+   (void)count;
+   (void)options;
+   (void)on_file;
+   (void)ctx;
+   return -1;
+}
 #endif  /* PLATFORM_MACHO */
 
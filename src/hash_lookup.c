@@ -20,8 +20,98 @@
  */
 
 #include <lookup/hash_lookup.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<sys/random.h>)
+#include <sys/random.h>
+#define HASH_HAVE_GETRANDOM   1
+#endif
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define HASH_MIN_CAPACITY     8
+#define HASH_MAX_CAPACITY     (1 << 30)   /* largest power of two an int holds */
+#define HASH_MAX_LOAD_NUM     7     /* grow beyond 7/8 full */
+#define HASH_MAX_LOAD_DEN     8
+#define HASH_MAX_PROBE        32    /* probe length that forces an early grow */
+#define HASH_MIGRATE_BATCH    8     /* old-generation slots drained per write */
+#define HASH_ARENA_CHUNK      (64 * 1024)
+#define HASH_BATCH            16    /* keys in flight per batched call */
+
+#if defined(__GNUC__)
+#define HASH_PREFETCH(addr)   __builtin_prefetch(addr)
+#define HASH_CTZ(mask)        __builtin_ctz(mask)
+#else
+#define HASH_PREFETCH(addr)   ((void)(addr))
+#define HASH_CTZ(mask)        __hash_ctz(mask)
+
+/* Index of the lowest set bit; 'mask' is never zero. */
+static int __hash_ctz(unsigned int mask)
+{
+   int bit = 0;
+   while (!(mask & 1)) {
+       mask >>= 1;
+       bit++;
+   }
+   return bit;
+}
+#endif
+
+#define HASH_IMAGE_MAGIC      0x54484b4cU   /* "LKHT" */
+#define HASH_IMAGE_VERSION    1
+
+/*
+ * On-disk image written by hash_table_save(). Everything is addressed by
+ * byte offsets from the start of the file, so the mapping can land at any
+ * address. The slots form the same Robin Hood layout as the in-memory
+ * table, hashed with lookup_hash64() and 'seed'. Integers are stored in
+ * host byte order; a foreign-endian file fails the magic check.
+ */
+struct HashImage {
+   uint32_t magic;
+   uint32_t version;
+   uint64_t file_size;
+   uint64_t seed;
+   uint64_t capacity;
+   uint64_t count;
+   uint64_t slots_offset;
+   uint64_t keys_offset;
+   uint64_t keys_size;
+   uint64_t checksum;      /* lookup_hash64() of the fields above, see below */
+};
+
+struct HashImageSlot {
+   uint64_t hash;          /* 0 = empty */
+   uint64_t value;
+   uint32_t key_offset;
+   uint32_t key_length;
+};
+
+/*
+ * Key arena: a list of chunks, newest first. Keys are appended to the
+ * head chunk; a key that does not fit starts a new one.
+ */
+struct HashArena {
+   struct HashArena *next;
+   size_t size;
+   size_t used;
+   char data[];
+};
 
 unsigned int hash_function(const char *str)
 {
@@ -32,59 +122,1087 @@ unsigned int hash_function(const char *str)
    return hash;
 }
 
+/*
+ * Default hash: wyhash final version 4 with its default secret, bit for bit
+ * (tests/hash_bench.c checks the published test vectors). Reads the key
+ * eight bytes at a time and folds each pair of words with a 64x64->128 bit
+ * multiply.
+ */
+#define WY_S0                 0x2d358dccaa6c78a5ULL
+#define WY_S1                 0x8bb84b93962eacc9ULL
+#define WY_S2                 0x4b33a62ed433d4a3ULL
+#define WY_S3                 0x4d5a2da51de1aa47ULL
+
+static void __wy_mum(uint64_t *a, uint64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+   __uint128_t r = (__uint128_t)*a * *b;
+   *a = (uint64_t)r;
+   *b = (uint64_t)(r >> 64);
+#else
+   uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+   uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+   uint64_t t = rl + (rm0 << 32), c = t < rl;
+   uint64_t lo = t + (rm1 << 32);
+   c += lo < t;
+   *a = lo;
+   *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static uint64_t __wy_mix(uint64_t a, uint64_t b)
+{
+   __wy_mum(&a, &b);
+   return a ^ b;
+}
+
+static uint64_t __wy_r8(const unsigned char *p)
+{
+   uint64_t v;
+   memcpy(&v, p, 8);
+   return v;
+}
+
+static uint64_t __wy_r4(const unsigned char *p)
+{
+   uint32_t v;
+   memcpy(&v, p, 4);
+   return v;
+}
+
+uint64_t lookup_hash64(const void *data, size_t len, uint64_t seed)
+{
+   const unsigned char *p = data;
+   uint64_t a, b;
+   seed ^= __wy_mix(seed ^ WY_S0, WY_S1);
+   if (len <= 16) {
+       if (len >= 4) {
+           size_t mid = (len >> 3) << 2;
+           a = (__wy_r4(p) << 32) | __wy_r4(p + mid);
+           b = (__wy_r4(p + len - 4) << 32) | __wy_r4(p + len - 4 - mid);
+       } else if (len > 0) {
+           a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+           b = 0;
+       } else {
+           a = b = 0;
+       }
+   } else {
+       size_t i = len;
+       if (i > 48) {
+           uint64_t see1 = seed, see2 = seed;
+           do {
+               seed = __wy_mix(__wy_r8(p) ^ WY_S1, __wy_r8(p + 8) ^ seed);
+               see1 = __wy_mix(__wy_r8(p + 16) ^ WY_S2, __wy_r8(p + 24) ^ see1);
+               see2 = __wy_mix(__wy_r8(p + 32) ^ WY_S3, __wy_r8(p + 40) ^ see2);
+               p += 48;
+               i -= 48;
+           } while (i > 48);
+           seed ^= see1 ^ see2;
+       }
+       while (i > 16) {
+           seed = __wy_mix(__wy_r8(p) ^ WY_S1, __wy_r8(p + 8) ^ seed);
+           p += 16;
+           i -= 16;
+       }
+       a = __wy_r8(p + i - 16);
+       b = __wy_r8(p + i - 8);
+   }
+   a ^= WY_S1;
+   b ^= seed;
+   __wy_mum(&a, &b);
+   return __wy_mix(a ^ WY_S0 ^ len, b ^ WY_S1);
+}
+
+/*
+ * A process-wide secret from the kernel's random pool, fetched once; zero
+ * where none is available, leaving the seed to the clock and addresses.
+ */
+static uint64_t __hash_secret(void)
+{
+   static atomic_ullong secret;
+   uint64_t value = atomic_load_explicit(&secret, memory_order_relaxed);
+#ifdef HASH_HAVE_GETRANDOM
+   if (value == 0) {
+       if (getrandom(&value, sizeof(value), GRND_NONBLOCK) != sizeof(value)) {
+           value = 0;
+       }
+       /* Racing first callers may each store their own; any one will do. */
+       atomic_store_explicit(&secret, value, memory_order_relaxed);
+   }
+#endif
+   return value;
+}
+
+/* A different seed per call, so tables cannot be flooded with precomputed keys. */
+uint64_t lookup_hash_seed(void)
+{
+   static atomic_ulong counter;
+   uint64_t entropy[5] = {
+       __hash_secret(),
+       (uint64_t)time(NULL),
+       (uint64_t)clock(),
+       (uint64_t)(uintptr_t)&entropy,
+       atomic_fetch_add(&counter, 1)
+   };
+   return lookup_hash64(entropy, sizeof(entropy), WY_S2);
+}
+
+/* Full 64-bit key hash; zero is reserved for empty slots. */
+static uint64_t __hash_key(HashFunc func, uint64_t seed, const char *key)
+{
+   uint64_t hash = func(key, strlen(key), seed);
+   return hash ? hash : 1;
+}
+
+static char* __arena_strdup(struct HashArena **arena, const char *key)
+{
+   size_t len = strlen(key) + 1;
+   struct HashArena *chunk = *arena;
+   if (!chunk || chunk->size - chunk->used < len) {
+       size_t size = len > HASH_ARENA_CHUNK ? len : HASH_ARENA_CHUNK;
+       chunk = malloc(sizeof(struct HashArena) + size);
+       if (!chunk) {
+           return NULL;
+       }
+       chunk->next = *arena;
+       chunk->size = size;
+       chunk->used = 0;
+       *arena = chunk;
+   }
+   char *copy = chunk->data + chunk->used;
+   memcpy(copy, key, len);
+   chunk->used += len;
+   return copy;
+}
+
+static void __arena_free(struct HashArena *arena)
+{
+   while (arena) {
+       struct HashArena *next = arena->next;
+       free(arena);
+       arena = next;
+   }
+}
+
+static char* __key_copy(HashTable *table, const char *key)
+{
+   if (table->flags & HASH_TABLE_ARENA) {
+       return __arena_strdup(&table->arena, key);
+   }
+   return strdup(key);
+}
+
+static void __key_release(const HashTable *table, char *key)
+{
+   if (!(table->flags & HASH_TABLE_ARENA)) {
+       free(key);
+   }
+}
+
+static int __probe_distance(const HashTable *table, int slot)
+{
+   unsigned int mask = table->capacity - 1;
+   return (slot - ((unsigned int)table->hashes[slot] & mask)) & mask;
+}
+
+static int __table_alloc(HashTable *table, int capacity)
+{
+   table->keys = calloc(capacity, sizeof(char*));
+   table->values = calloc(capacity, sizeof(void*));
+   table->hashes = calloc(capacity, sizeof(uint64_t));
+   if (!table->keys || !table->values || !table->hashes) {
+       free(table->keys);
+       free(table->values);
+       free(table->hashes);
+       return 0;
+   }
+   table->capacity = capacity;
+   return 1;
+}
+
+static int __slot_find(const HashTable *table, const char *key, uint64_t hash)
+{
+   unsigned int mask = table->capacity - 1;
+   int slot = hash & mask;
+   for (int dist = 0; ; dist++) {
+       uint64_t h = table->hashes[slot];
+       if (!h || __probe_distance(table, slot) < dist) {
+           return -1;  // Robin Hood invariant: key would have been placed by now
+       }
+       if (h == hash && strcmp(table->keys[slot], key) == 0) {
+           return slot;
+       }
+       slot = (slot + 1) & mask;
+   }
+}
+
+/*
+ * Place an entry whose key is known to be absent, displacing richer
+ * entries along the way. Returns the longest probe walked.
+ */
+static int __slot_place(HashTable *table, char *key, void *value, uint64_t hash)
+{
+   unsigned int mask = table->capacity - 1;
+   int slot = hash & mask;
+   int dist = 0, longest = 0;
+   for (;;) {
+       if (!table->hashes[slot]) {
+           table->keys[slot] = key;
+           table->values[slot] = value;
+           table->hashes[slot] = hash;
+           return dist > longest ? dist : longest;
+       }
+       int existing = __probe_distance(table, slot);
+       if (existing < dist) {
+           char *k = table->keys[slot];
+           void *v = table->values[slot];
+           uint64_t h = table->hashes[slot];
+           table->keys[slot] = key;
+           table->values[slot] = value;
+           table->hashes[slot] = hash;
+           key = k;
+           value = v;
+           hash = h;
+           if (dist > longest) {
+               longest = dist;
+           }
+           dist = existing;
+       }
+       slot = (slot + 1) & mask;
+       dist++;
+   }
+}
+
+/* Backward-shift deletion: pull the rest of the cluster one slot closer to home. */
+static void __slot_clear(HashTable *table, int slot)
+{
+   unsigned int mask = table->capacity - 1;
+   int next = (slot + 1) & mask;
+   while (table->hashes[next] && __probe_distance(table, next) > 0) {
+       table->keys[slot] = table->keys[next];
+       table->values[slot] = table->values[next];
+       table->hashes[slot] = table->hashes[next];
+       slot = next;
+       next = (next + 1) & mask;
+   }
+   table->keys[slot] = NULL;
+   table->values[slot] = NULL;
+   table->hashes[slot] = 0;
+}
+
+/*
+ * Move up to 'budget' entries from the previous generation. Each move is
+ * an ordinary backward-shift delete, so the old arrays stay a valid Robin
+ * Hood table and lookups can keep probing them until they are empty.
+ */
+static void __table_migrate(HashTable *table, int budget)
+{
+   HashTable *old = table->old;
+   if (!old) {
+       return;
+   }
+   while (old->size > 0 && budget-- > 0) {
+       int slot = table->migrate_pos;
+       if (!old->hashes[slot]) {
+           table->migrate_pos = (slot + 1) & (old->capacity - 1);
+           continue;
+       }
+       char *key = old->keys[slot];
+       void *value = old->values[slot];
+       uint64_t hash = old->hashes[slot];
+       __slot_clear(old, slot);
+       old->size--;
+       __slot_place(table, key, value, hash);
+   }
+   if (old->size == 0) {
+       free(old->keys);
+       free(old->values);
+       free(old->hashes);
+       free(old);
+       table->old = NULL;
+       table->migrate_pos = 0;
+   }
+}
+
+static int __table_grow(HashTable *table, int capacity)
+{
+   if (capacity > HASH_MAX_CAPACITY) {
+       return 0;
+   }
+   /* Only one resize in flight: finish the previous one first. */
+   while (table->old) {
+       __table_migrate(table, table->old->capacity);
+   }
+
+   HashTable *old = malloc(sizeof(HashTable));
+   if (!old) {
+       return 0;
+   }
+   *old = *table;
+   old->size = table->size;
+   old->old = NULL;
+   if (!__table_alloc(table, capacity)) {
+       *table = *old;
+       free(old);
+       return 0;
+   }
+   old->arena = NULL;  // still owned by 'table'
+   table->old = old;
+   table->migrate_pos = 0;
+   if (old->size == 0) {
+       __table_migrate(table, 0);
+   }
+   return 1;
+}
+
+/*
+ * Catches a torn or accidentally damaged header. Anyone can recompute it,
+ * so it is no defence against a crafted file: hash_table_open_mmap() and
+ * __image_find() bounds-check every offset regardless.
+ */
+static uint64_t __image_checksum(const struct HashImage *image)
+{
+   return lookup_hash64(image, offsetof(struct HashImage, checksum), HASH_IMAGE_MAGIC);
+}
+
+/* Robin Hood probe over mapped slots. Offsets are bounds-checked, never trusted. */
+static int __image_find(const HashTable *table, const char *key, void **value)
+{
+   const struct HashImage *image = table->image;
+   const struct HashImageSlot *slots =
+       (const struct HashImageSlot *)((const char *)image + image->slots_offset);
+   const char *key_data = (const char *)image + image->keys_offset;
+   size_t len = strlen(key);
+   uint64_t hash = __hash_key(lookup_hash64, image->seed, key);
+   uint64_t mask = image->capacity - 1;
+   uint64_t slot = hash & mask;
+   for (uint64_t dist = 0; dist <= mask; dist++) {
+       const struct HashImageSlot *s = &slots[slot];
+       if (!s->hash || ((slot - (s->hash & mask)) & mask) < dist) {
+           return 0;
+       }
+       if (s->hash == hash && s->key_length == len
+           && (uint64_t)s->key_offset + len < image->keys_size
+           && memcmp(key_data + s->key_offset, key, len) == 0) {
+           *value = (void *)(uintptr_t)s->value;
+           return 1;
+       }
+       slot = (slot + 1) & mask;
+   }
+   return 0;
+}
+
 HashTable* hash_table_create(int capacity)
 {
+   return hash_table_create_ex(capacity, 0);
+}
+
+HashTable* hash_table_create_ex(int capacity, int flags)
+{
+   if (capacity > HASH_MAX_CAPACITY) {
+       return NULL;
+   }
    HashTable *table = malloc(sizeof(HashTable));
-   table->capacity = capacity;
+   if (!table) {
+       return NULL;
+   }
+   int rounded = HASH_MIN_CAPACITY;
+   while (rounded < capacity) {
+       rounded <<= 1;
+   }
+   if (!__table_alloc(table, rounded)) {
+       free(table);
+       return NULL;
+   }
    table->size = 0;
-   table->keys = calloc(capacity, sizeof(char*));
-   table->values = calloc(capacity, sizeof(void*));
+   table->old = NULL;
+   table->migrate_pos = 0;
+   table->flags = flags;
+   table->arena = NULL;
+   table->hash_func = lookup_hash64;
+   table->seed = lookup_hash_seed();
+   table->image = NULL;
+   table->image_size = 0;
    return table;
 }
 
+int hash_table_set_hash(HashTable *table, HashFunc func, uint64_t seed)
+{
+   if (table->size > 0) {
+       return 0;  // cached hashes would no longer match
+   }
+   table->hash_func = func ? func : lookup_hash64;
+   table->seed = seed;
+   return 1;
+}
+
 int hash_lookup(HashTable *table, const char *key, void **value)
 {
-   unsigned int hash = hash_function(key) % table->capacity;
-   if (table->keys[hash] && strcmp(table->keys[hash], key) == 0) {
-       *value = table->values[hash];
+   if (table->image) {
+       return __image_find(table, key, value);
+   }
+   uint64_t hash = __hash_key(table->hash_func, table->seed, key);
+   int slot = __slot_find(table, key, hash);
+   if (slot >= 0) {
+       *value = table->values[slot];
        return 1;  // Found
    }
+   if (table->old && (slot = __slot_find(table->old, key, hash)) >= 0) {
+       *value = table->old->values[slot];
+       return 1;  // Found, not migrated yet
+   }
    return 0;  // Not found
 }
 
-int hash_insert(HashTable *table, const char *key, void *value)
+static int __insert_hashed(HashTable *table, const char *key, void *value,
+                           uint64_t hash)
 {
-   unsigned int hash = hash_function(key) % table->capacity;
-   if (table->keys[hash]) {
-       free(table->keys[hash]);
+   __table_migrate(table, HASH_MIGRATE_BATCH);
+
+   int slot = __slot_find(table, key, hash);
+   if (slot >= 0) {
+       table->values[slot] = value;
+       return 1;
+   }
+   if (table->old && (slot = __slot_find(table->old, key, hash)) >= 0) {
+       table->old->values[slot] = value;
+       return 1;
+   }
+
+   if ((long)(table->size + 1) * HASH_MAX_LOAD_DEN
+       > (long)table->capacity * HASH_MAX_LOAD_NUM) {
+       if (table->capacity == HASH_MAX_CAPACITY
+           || !__table_grow(table, table->capacity * 2)) {
+           return 0;
+       }
+   }
+
+   char *copy = __key_copy(table, key);
+   if (!copy) {
+       return 0;
    }
-   table->keys[hash] = strdup(key);
-   table->values[hash] = value;
+   int probe = __slot_place(table, copy, value, hash);
    table->size++;
+
+   /*
+    * A long probe at moderate load means clustering; grow early to keep
+    * probe sequences bounded. Below half load no amount of growth helps.
+    */
+   if (probe > HASH_MAX_PROBE && table->size * 2 > table->capacity
+       && table->capacity < HASH_MAX_CAPACITY) {
+       __table_grow(table, table->capacity * 2);
+   }
    return 1;
 }
 
+int hash_insert(HashTable *table, const char *key, void *value)
+{
+   if (table->image) {
+       return 0;  // mapped tables are read-only
+   }
+   return __insert_hashed(table, key, value,
+                          __hash_key(table->hash_func, table->seed, key));
+}
+
 int hash_remove(HashTable *table, const char *key)
 {
-   unsigned int hash = hash_function(key) % table->capacity;
-   if (table->keys[hash] && strcmp(table->keys[hash], key) == 0) {
-       free(table->keys[hash]);
-       table->keys[hash] = NULL;
-       table->values[hash] = NULL;
+   if (table->image) {
+       return 0;
+   }
+   uint64_t hash = __hash_key(table->hash_func, table->seed, key);
+   __table_migrate(table, HASH_MIGRATE_BATCH);
+
+   int slot = __slot_find(table, key, hash);
+   if (slot >= 0) {
+       __key_release(table, table->keys[slot]);
+       __slot_clear(table, slot);
+       table->size--;
+       return 1;
+   }
+   HashTable *old = table->old;
+   if (old && (slot = __slot_find(old, key, hash)) >= 0) {
+       __key_release(table, old->keys[slot]);
+       __slot_clear(old, slot);
+       old->size--;
        table->size--;
+       __table_migrate(table, 0);
        return 1;
    }
    return 0;
 }
 
+/*
+ * Batched lookup. Each group of HASH_BATCH keys goes through three passes:
+ * hash everything and prefetch the home slots, then prefetch the key
+ * bytes of slots whose cached hash already matches, then probe. The
+ * cache misses of independent keys overlap instead of serializing.
+ */
+int hash_lookup_many(HashTable *table, const char **keys, int n,
+                     void **values_out, int *found_out)
+{
+   uint64_t hashes[HASH_BATCH];
+   unsigned int mask = table->capacity - 1;
+   int found = 0;
+
+   if (table->image) {
+       for (int i = 0; i < n; i++) {
+           values_out[i] = NULL;
+           int hit = __image_find(table, keys[i], &values_out[i]);
+           if (found_out) {
+               found_out[i] = hit;
+           }
+           found += hit;
+       }
+       return found;
+   }
+
+   for (int base = 0; base < n; base += HASH_BATCH) {
+       int count = n - base < HASH_BATCH ? n - base : HASH_BATCH;
+       for (int i = 0; i < count; i++) {
+           hashes[i] = __hash_key(table->hash_func, table->seed, keys[base + i]);
+           unsigned int slot = hashes[i] & mask;
+           HASH_PREFETCH(&table->hashes[slot]);
+           HASH_PREFETCH(&table->keys[slot]);
+       }
+       for (int i = 0; i < count; i++) {
+           unsigned int slot = hashes[i] & mask;
+           if (table->hashes[slot] == hashes[i]) {
+               HASH_PREFETCH(table->keys[slot]);
+               HASH_PREFETCH(&table->values[slot]);
+           }
+       }
+       for (int i = 0; i < count; i++) {
+           const char *key = keys[base + i];
+           void *value = NULL;
+           int slot = __slot_find(table, key, hashes[i]);
+           if (slot >= 0) {
+               value = table->values[slot];
+           } else if (table->old && (slot = __slot_find(table->old, key, hashes[i])) >= 0) {
+               value = table->old->values[slot];
+           }
+           values_out[base + i] = value;
+           if (found_out) {
+               found_out[base + i] = slot >= 0;
+           }
+           found += slot >= 0;
+       }
+   }
+   return found;
+}
+
+/*
+ * Bulk insert. The table is sized for all 'n' keys up front so the load
+ * does not trigger a chain of doublings, and home slots are prefetched a
+ * batch at a time. Returns the number of keys inserted or updated.
+ */
+int hash_insert_many(HashTable *table, const char **keys, void **values, int n)
+{
+   uint64_t hashes[HASH_BATCH];
+   int inserted = 0;
+
+   if (table->image) {
+       return 0;
+   }
+
+   int capacity = table->capacity;
+   while (capacity < HASH_MAX_CAPACITY
+          && ((long)table->size + n) * HASH_MAX_LOAD_DEN > (long)capacity * HASH_MAX_LOAD_NUM) {
+       capacity <<= 1;
+   }
+   if (capacity > table->capacity) {
+       __table_grow(table, capacity);
+   }
+
+   for (int base = 0; base < n; base += HASH_BATCH) {
+       int count = n - base < HASH_BATCH ? n - base : HASH_BATCH;
+       unsigned int mask = table->capacity - 1;
+       for (int i = 0; i < count; i++) {
+           hashes[i] = __hash_key(table->hash_func, table->seed, keys[base + i]);
+           HASH_PREFETCH(&table->hashes[hashes[i] & mask]);
+       }
+       for (int i = 0; i < count; i++) {
+           inserted += __insert_hashed(table, keys[base + i], values[base + i], hashes[i]);
+       }
+   }
+   return inserted;
+}
+
 void hash_table_free(HashTable *table)
+{
+   if (table->image) {
+       munmap((void *)table->image, table->image_size);
+       free(table);
+       return;
+   }
+   if (table->old) {
+       hash_table_free(table->old);
+   }
+   if (table->flags & HASH_TABLE_ARENA) {
+       __arena_free(table->arena);
+   } else {
+       for (int i = 0; i < table->capacity; i++) {
+           if (table->keys[i]) {
+               free(table->keys[i]);
+           }
+       }
+   }
+   free(table->keys);
+   free(table->values);
+   free(table->hashes);
+   free(table);
+}
+
+static int __write_all(int fd, const void *data, size_t size)
+{
+   const char *p = data;
+   while (size > 0) {
+       ssize_t n = write(fd, p, size);
+       if (n < 0) {
+           return 0;
+       }
+       p += n;
+       size -= n;
+   }
+   return 1;
+}
+
+/*
+ * Create a unique temporary file 'tmp' next to 'path'. Unlike mkstemp(),
+ * which always creates mode 0600, this passes 0666 to open() so the saved
+ * file gets the caller's umask like any other file it creates.
+ */
+static int __create_temp(const char *path, char *tmp, size_t tmp_size)
+{
+   static atomic_uint counter;
+   for (int attempt = 0; attempt < 100; attempt++) {
+       if (snprintf(tmp, tmp_size, "%s.%ld.%u", path, (long)getpid(),
+                    atomic_fetch_add(&counter, 1)) >= (int)tmp_size) {
+           errno = ENAMETOOLONG;
+           return -1;
+       }
+       int fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+       if (fd != -1 || errno != EEXIST) {
+           return fd;
+       }
+   }
+   return -1;
+}
+
+static void __image_place(struct HashImageSlot *slots, uint64_t mask, struct HashImageSlot entry)
+{
+   uint64_t slot = entry.hash & mask;
+   uint64_t dist = 0;
+   while (slots[slot].hash) {
+       uint64_t existing = (slot - (slots[slot].hash & mask)) & mask;
+       if (existing < dist) {
+           struct HashImageSlot displaced = slots[slot];
+           slots[slot] = entry;
+           entry = displaced;
+           dist = existing;
+       }
+       slot = (slot + 1) & mask;
+       dist++;
+   }
+   slots[slot] = entry;
+}
+
+static int __image_add(const HashTable *gen, const HashTable *table, struct HashImageSlot *slots,
+                       uint64_t mask, char *key_data, size_t *key_offset)
+{
+   for (int i = 0; i < gen->capacity; i++) {
+       if (!gen->keys[i]) {
+           continue;
+       }
+       size_t len = strlen(gen->keys[i]);
+       if (*key_offset + len + 1 > UINT32_MAX) {
+           return 0;
+       }
+       struct HashImageSlot entry;
+       entry.hash = table->hash_func == lookup_hash64
+                    ? gen->hashes[i]
+                    : __hash_key(lookup_hash64, table->seed, gen->keys[i]);
+       entry.value = (uint64_t)(uintptr_t)gen->values[i];
+       entry.key_offset = (uint32_t)*key_offset;
+       entry.key_length = (uint32_t)len;
+       memcpy(key_data + *key_offset, gen->keys[i], len + 1);
+       *key_offset += len + 1;
+       __image_place(slots, mask, entry);
+   }
+   return 1;
+}
+
+/*
+ * Write the table as a mappable image. The file is written to a unique
+ * temporary file next to 'path', synced and renamed into place, so
+ * concurrent savers never share a temporary file and processes that have
+ * the old file mapped keep a consistent view. Values are stored as their
+ * raw pointer bits.
+ */
+int hash_table_save(HashTable *table, const char *path)
+{
+   size_t tmp_len = strlen(path) + 32;
+   char *tmp_path = malloc(tmp_len);
+   if (!tmp_path) {
+       return 0;
+   }
+
+   int ok = 0;
+   struct HashImageSlot *slots = NULL;
+   char *key_data = NULL;
+   int fd = __create_temp(path, tmp_path, tmp_len);
+   if (fd == -1) {
+       free(tmp_path);
+       return 0;
+   }
+
+   if (table->image) {
+       ok = __write_all(fd, table->image, table->image_size);
+   } else {
+       uint64_t capacity = HASH_MIN_CAPACITY;
+       while ((uint64_t)table->size * HASH_MAX_LOAD_DEN > capacity * HASH_MAX_LOAD_NUM) {
+           capacity <<= 1;
+       }
+       size_t key_size = 1;
+       for (const HashTable *gen = table; gen; gen = gen->old) {
+           for (int i = 0; i < gen->capacity; i++) {
+               if (gen->keys[i]) {
+                   key_size += strlen(gen->keys[i]) + 1;
+               }
+           }
+       }
+       slots = calloc(capacity, sizeof(struct HashImageSlot));
+       key_data = malloc(key_size);
+       size_t key_offset = 0;
+       if (slots && key_data
+           && __image_add(table, table, slots, capacity - 1, key_data, &key_offset)
+           && (!table->old
+               || __image_add(table->old, table, slots, capacity - 1, key_data, &key_offset))) {
+           struct HashImage image;
+           memset(&image, 0, sizeof(image));
+           image.magic = HASH_IMAGE_MAGIC;
+           image.version = HASH_IMAGE_VERSION;
+           image.seed = table->seed;
+           image.capacity = capacity;
+           image.count = table->size;
+           image.slots_offset = sizeof(struct HashImage);
+           image.keys_offset = image.slots_offset + capacity * sizeof(struct HashImageSlot);
+           image.keys_size = key_offset + 1;
+           image.file_size = image.keys_offset + image.keys_size;
+           image.checksum = __image_checksum(&image);
+           key_data[key_offset] = '\0';
+           ok = __write_all(fd, &image, sizeof(image))
+                && __write_all(fd, slots, capacity * sizeof(struct HashImageSlot))
+                && __write_all(fd, key_data, image.keys_size);
+       }
+   }
+
+   if (ok && fsync(fd) != 0) {
+       ok = 0;
+   }
+   if (close(fd) != 0) {
+       ok = 0;
+   }
+   if (ok && rename(tmp_path, path) != 0) {
+       ok = 0;
+   }
+   if (!ok) {
+       unlink(tmp_path);
+   }
+   free(slots);
+   free(key_data);
+   free(tmp_path);
+   return ok;
+}
+
+/*
+ * Map an image written by hash_table_save(). The returned table answers
+ * hash_lookup() and hash_lookup_many() straight from the mapped pages;
+ * inserts and removals fail. hash_table_free() unmaps it.
+ */
+HashTable* hash_table_open_mmap(const char *path)
+{
+   int fd = open(path, O_RDONLY);
+   if (fd == -1) {
+       return NULL;
+   }
+   struct stat st;
+   if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct HashImage)) {
+       close(fd);
+       return NULL;
+   }
+   size_t size = st.st_size;
+   void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if (map == MAP_FAILED) {
+       return NULL;
+   }
+
+   const struct HashImage *image = map;
+   uint64_t capacity = image->capacity;
+   int valid = image->magic == HASH_IMAGE_MAGIC
+               && image->version == HASH_IMAGE_VERSION
+               && image->checksum == __image_checksum(image)
+               && image->file_size == size
+               && capacity > 0 && (capacity & (capacity - 1)) == 0
+               && image->count < capacity && image->count <= INT32_MAX
+               && image->slots_offset % 8 == 0
+               && image->slots_offset >= sizeof(struct HashImage)
+               && image->slots_offset <= image->keys_offset
+               && image->keys_offset <= size
+               && capacity <= (image->keys_offset - image->slots_offset)
+                              / sizeof(struct HashImageSlot)
+               && image->keys_size > 0
+               && image->keys_size <= size - image->keys_offset;
+   HashTable *table = valid ? calloc(1, sizeof(HashTable)) : NULL;
+   if (!table) {
+       munmap(map, size);
+       return NULL;
+   }
+#ifdef MADV_RANDOM
+   madvise(map, size, MADV_RANDOM);
+#endif
+   table->image = image;
+   table->image_size = size;
+   table->size = (int)image->count;
+   table->hash_func = lookup_hash64;
+   table->seed = image->seed;
+   return table;
+}
+
+/*
+ * Group-probing table.
+ *
+ * Groups are 16 aligned slots. Probing visits whole groups in triangular
+ * order, which covers every group when the group count is a power of two.
+ * A lookup stops at the first group holding an EMPTY byte.
+ */
+#define GROUP_WIDTH           16
+#define CTRL_EMPTY            0x80
+#define CTRL_DELETED          0xFE
+
+/* Bitmask of the slots in the group whose control byte equals 'byte'. */
+static unsigned int __group_match(const unsigned char *ctrl, unsigned char byte)
+{
+#if defined(__SSE2__)
+   __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+   return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)byte)));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+   static const unsigned char weights[16] = {
+       1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128
+   };
+   uint8x16_t eq = vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(byte));
+   uint8x16_t bits = vandq_u8(eq, vld1q_u8(weights));
+   return vaddv_u8(vget_low_u8(bits)) | (vaddv_u8(vget_high_u8(bits)) << 8);
+#else
+   unsigned int mask = 0;
+   for (int i = 0; i < GROUP_WIDTH; i++) {
+       mask |= (unsigned int)(ctrl[i] == byte) << i;
+   }
+   return mask;
+#endif
+}
+
+/* Bitmask of the EMPTY or DELETED slots; both have the high bit set. */
+static unsigned int __group_match_free(const unsigned char *ctrl)
+{
+#if defined(__SSE2__)
+   return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#else
+   unsigned int mask = 0;
+   for (int i = 0; i < GROUP_WIDTH; i++) {
+       mask |= (unsigned int)(ctrl[i] >> 7) << i;
+   }
+   return mask;
+#endif
+}
+
+static int __group_find(const GroupHashTable *table, const char *key, uint64_t hash)
+{
+   unsigned int groups = table->capacity / GROUP_WIDTH;
+   unsigned int group = (hash >> 7) & (groups - 1);
+   unsigned char tag = hash & 0x7f;
+   for (unsigned int step = 1; step <= groups; step++) {
+       const unsigned char *ctrl = table->ctrl + group * GROUP_WIDTH;
+       unsigned int match = __group_match(ctrl, tag);
+       while (match) {
+           int slot = group * GROUP_WIDTH + HASH_CTZ(match);
+           if (strcmp(table->keys[slot], key) == 0) {
+               return slot;
+           }
+           match &= match - 1;
+       }
+       if (__group_match(ctrl, CTRL_EMPTY)) {
+           return -1;
+       }
+       group = (group + step) & (groups - 1);
+   }
+   return -1;
+}
+
+/* First EMPTY or DELETED slot on the probe sequence of 'hash'. */
+static int __group_find_free(const GroupHashTable *table, uint64_t hash)
+{
+   unsigned int groups = table->capacity / GROUP_WIDTH;
+   unsigned int group = (hash >> 7) & (groups - 1);
+   for (unsigned int step = 1; ; step++) {
+       unsigned int match = __group_match_free(table->ctrl + group * GROUP_WIDTH);
+       if (match) {
+           return group * GROUP_WIDTH + HASH_CTZ(match);
+       }
+       group = (group + step) & (groups - 1);
+   }
+}
+
+static int __group_alloc(GroupHashTable *table, int capacity)
+{
+   table->ctrl = malloc(capacity);
+   table->keys = calloc(capacity, sizeof(char*));
+   table->values = calloc(capacity, sizeof(void*));
+   table->hashes = malloc(capacity * sizeof(uint64_t));
+   if (!table->ctrl || !table->keys || !table->values || !table->hashes) {
+       free(table->ctrl);
+       free(table->keys);
+       free(table->values);
+       free(table->hashes);
+       return 0;
+   }
+   memset(table->ctrl, CTRL_EMPTY, capacity);
+   table->capacity = capacity;
+   table->growth_left = capacity / 8 * 7 - table->size;
+   return 1;
+}
+
+/*
+ * Out of EMPTY slots. Double if live entries are the problem, otherwise
+ * rebuild at the same capacity to flush the DELETED markers.
+ */
+static int __group_rehash(GroupHashTable *table)
+{
+   GroupHashTable old = *table;
+   int capacity = table->capacity;
+   if ((long)(table->size + 1) * 16 > (long)capacity * 7) {
+       if (capacity == HASH_MAX_CAPACITY) {
+           return 0;
+       }
+       capacity *= 2;
+   }
+   if (!__group_alloc(table, capacity)) {
+       *table = old;
+       return 0;
+   }
+   for (int i = 0; i < old.capacity; i++) {
+       if (old.ctrl[i] & 0x80) {
+           continue;
+       }
+       uint64_t hash = old.hashes[i];
+       int slot = __group_find_free(table, hash);
+       table->ctrl[slot] = hash & 0x7f;
+       table->keys[slot] = old.keys[i];
+       table->values[slot] = old.values[i];
+       table->hashes[slot] = hash;
+   }
+   free(old.ctrl);
+   free(old.keys);
+   free(old.values);
+   free(old.hashes);
+   return 1;
+}
+
+GroupHashTable* group_hash_table_create(int capacity)
+{
+   if (capacity > HASH_MAX_CAPACITY) {
+       return NULL;
+   }
+   GroupHashTable *table = malloc(sizeof(GroupHashTable));
+   if (!table) {
+       return NULL;
+   }
+   int rounded = GROUP_WIDTH;
+   while (rounded < capacity) {
+       rounded <<= 1;
+   }
+   table->size = 0;
+   table->seed = lookup_hash_seed();
+   if (!__group_alloc(table, rounded)) {
+       free(table);
+       return NULL;
+   }
+   return table;
+}
+
+int group_hash_lookup(GroupHashTable *table, const char *key, void **value)
+{
+   int slot = __group_find(table, key, __hash_key(lookup_hash64, table->seed, key));
+   if (slot >= 0) {
+       *value = table->values[slot];
+       return 1;  // Found
+   }
+   return 0;  // Not found
+}
+
+int group_hash_insert(GroupHashTable *table, const char *key, void *value)
+{
+   uint64_t hash = __hash_key(lookup_hash64, table->seed, key);
+   int slot = __group_find(table, key, hash);
+   if (slot >= 0) {
+       table->values[slot] = value;
+       return 1;
+   }
+   if (table->growth_left == 0 && !__group_rehash(table)) {
+       return 0;
+   }
+
+   char *copy = strdup(key);
+   if (!copy) {
+       return 0;
+   }
+   slot = __group_find_free(table, hash);
+   if (table->ctrl[slot] == CTRL_EMPTY) {
+       table->growth_left--;
+   }
+   table->ctrl[slot] = hash & 0x7f;
+   table->keys[slot] = copy;
+   table->values[slot] = value;
+   table->hashes[slot] = hash;
+   table->size++;
+   return 1;
+}
+
+int group_hash_remove(GroupHashTable *table, const char *key)
+{
+   int slot = __group_find(table, key, __hash_key(lookup_hash64, table->seed, key));
+   if (slot < 0) {
+       return 0;
+   }
+   free(table->keys[slot]);
+   table->keys[slot] = NULL;
+   table->values[slot] = NULL;
+
+   /*
+    * A group that still has an EMPTY slot has never been full, so no probe
+    * ever continued past it and the slot can simply become EMPTY again.
+    */
+   const unsigned char *group = table->ctrl + slot / GROUP_WIDTH * GROUP_WIDTH;
+   if (__group_match(group, CTRL_EMPTY)) {
+       table->ctrl[slot] = CTRL_EMPTY;
+       table->growth_left++;
+   } else {
+       table->ctrl[slot] = CTRL_DELETED;
+   }
+   table->size--;
+   return 1;
+}
+
+void group_hash_table_free(GroupHashTable *table)
 {
    for (int i = 0; i < table->capacity; i++) {
-       if (table->keys[i]) {
+       if (!(table->ctrl[i] & 0x80)) {
            free(table->keys[i]);
        }
    }
+   free(table->ctrl);
    free(table->keys);
    free(table->values);
+   free(table->hashes);
    free(table);
 }
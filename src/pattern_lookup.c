@@ -0,0 +1,578 @@
+/*
+ * pattern_lookup.c - Multi-pattern buffer and file scanning
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <lookup/pattern_lookup.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define PATTERN_X86_DISPATCH  1
+#endif
+
+#define TEDDY_MAX_PATTERNS    64
+#define TEDDY_BUCKETS         8
+#define TEDDY_MAX_WIDTH       3         /* leading bytes fingerprinted */
+#define PATTERN_DFA_MAX_CELLS (1 << 22) /* dense DFA limit, in transitions */
+#define PATTERN_NONE          UINT32_MAX
+
+/* Nibble tables: bit b of lo[n] is set if a bucket-b pattern has low nibble n. */
+struct NibbleMasks {
+   uint8_t lo[16];
+   uint8_t hi[16];
+};
+
+struct PatternMatcher {
+   int count;
+   char *data;                /* pattern bytes, back to back */
+   size_t *offsets;
+   size_t *lengths;
+   int ssse3;                 /* set from cpuid by pattern_matcher_build */
+
+   /* Teddy */
+   int teddy;
+   int width;
+   struct NibbleMasks masks[TEDDY_MAX_WIDTH];
+   int bucket_start[TEDDY_BUCKETS + 1];
+   int *bucket_patterns;
+
+   /* Aho-Corasick */
+   uint32_t states;
+   unsigned char classes[256];
+   uint32_t class_count;
+   uint32_t *dfa;             /* states x class_count, or NULL */
+   uint32_t *edge_start;      /* sparse edges of state s: [edge_start[s], edge_start[s + 1]) */
+   unsigned char *edge_byte;
+   uint32_t *edge_next;
+   uint32_t *fail;
+   uint32_t *term;            /* first pattern ending at the state */
+   uint32_t *dict;            /* nearest suffix state with a pattern, 0 if none */
+   uint32_t *pattern_next;    /* next pattern with identical bytes */
+   struct NibbleMasks start;  /* bytes that leave the root, bit 0 */
+   unsigned char starts[256];
+};
+
+static const unsigned char* __pattern(const PatternMatcher *m, int p)
+{
+   return (const unsigned char *)m->data + m->offsets[p];
+}
+
+static void __nibble_set(struct NibbleMasks *masks, unsigned char c, uint8_t bits)
+{
+   masks->lo[c & 0xf] |= bits;
+   masks->hi[c >> 4] |= bits;
+}
+
+static uint8_t __nibble_get(const struct NibbleMasks *masks, unsigned char c)
+{
+   return masks->lo[c & 0xf] & masks->hi[c >> 4];
+}
+
+#ifdef PATTERN_X86_DISPATCH
+__attribute__((target("ssse3")))
+static __m128i __nibble_lookup(const struct NibbleMasks *masks, __m128i c)
+{
+   __m128i low = _mm_and_si128(c, _mm_set1_epi8(0x0f));
+   __m128i high = _mm_and_si128(_mm_srli_epi16(c, 4), _mm_set1_epi8(0x0f));
+   return _mm_and_si128(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)masks->lo), low),
+                        _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)masks->hi), high));
+}
+
+#endif
+
+/*
+ * Teddy
+ */
+struct TeddySort {
+   const PatternMatcher *matcher;
+   int pattern;
+};
+
+static int __teddy_sort_cmp(const void *a, const void *b)
+{
+   const struct TeddySort *x = a, *y = b;
+   const PatternMatcher *m = x->matcher;
+   int cmp = memcmp(__pattern(m, x->pattern), __pattern(m, y->pattern), m->width);
+   return cmp ? cmp : x->pattern - y->pattern;
+}
+
+/*
+ * Patterns sharing leading bytes go to the same bucket, so a bucket's
+ * nibble masks stay selective.
+ */
+static int __teddy_build(PatternMatcher *m, int live, size_t shortest)
+{
+   m->teddy = 1;
+   m->width = shortest < TEDDY_MAX_WIDTH ? (int)shortest : TEDDY_MAX_WIDTH;
+   m->bucket_patterns = malloc(sizeof(int) * (live + 1));
+   struct TeddySort *sorted = malloc(sizeof(struct TeddySort) * (live + 1));
+   if (!m->bucket_patterns || !sorted) {
+       free(sorted);
+       return 0;
+   }
+   int n = 0;
+   for (int p = 0; p < m->count; p++) {
+       if (m->lengths[p] > 0) {
+           sorted[n].matcher = m;
+           sorted[n].pattern = p;
+           n++;
+       }
+   }
+   qsort(sorted, n, sizeof(struct TeddySort), __teddy_sort_cmp);
+   for (int b = 0; b <= TEDDY_BUCKETS; b++) {
+       m->bucket_start[b] = (int)((long)n * b / TEDDY_BUCKETS);
+   }
+   for (int b = 0; b < TEDDY_BUCKETS; b++) {
+       for (int i = m->bucket_start[b]; i < m->bucket_start[b + 1]; i++) {
+           int p = sorted[i].pattern;
+           m->bucket_patterns[i] = p;
+           for (int j = 0; j < m->width; j++) {
+               __nibble_set(&m->masks[j], __pattern(m, p)[j], (uint8_t)(1u << b));
+           }
+       }
+   }
+   free(sorted);
+   return 1;
+}
+
+/* Compare the patterns of the buckets in 'bits' against position 'pos'. */
+static int __teddy_verify(const PatternMatcher *m, const unsigned char *buf, size_t len,
+                          size_t pos, unsigned int bits, PatternMatchFunc on_match, void *ctx,
+                          long *matches)
+{
+   while (bits) {
+       int b = __builtin_ctz(bits);
+       bits &= bits - 1;
+       for (int i = m->bucket_start[b]; i < m->bucket_start[b + 1]; i++) {
+           int p = m->bucket_patterns[i];
+           if (m->lengths[p] <= len - pos
+               && memcmp(buf + pos, __pattern(m, p), m->lengths[p]) == 0) {
+               (*matches)++;
+               if (on_match(p, pos, ctx)) {
+                   return 1;
+               }
+           }
+       }
+   }
+   return 0;
+}
+
+#ifdef PATTERN_X86_DISPATCH
+/* Scan whole 16-byte windows; returns where the scalar tail starts. */
+__attribute__((target("ssse3")))
+static size_t __teddy_scan_ssse3(const PatternMatcher *m, const unsigned char *buf, size_t len,
+                                 PatternMatchFunc on_match, void *ctx, long *matches, int *stop)
+{
+   size_t pos = 0;
+   for (; pos + 16 + m->width - 1 <= len; pos += 16) {
+       __m128i cand = _mm_set1_epi8((char)0xff);
+       for (int j = 0; j < m->width; j++) {
+           __m128i c = _mm_loadu_si128((const __m128i *)(buf + pos + j));
+           cand = _mm_and_si128(cand, __nibble_lookup(&m->masks[j], c));
+       }
+       unsigned int hits = ~_mm_movemask_epi8(_mm_cmpeq_epi8(cand, _mm_setzero_si128())) & 0xffff;
+       if (!hits) {
+           continue;
+       }
+       uint8_t buckets[16];
+       _mm_storeu_si128((__m128i *)buckets, cand);
+       while (hits) {
+           int k = __builtin_ctz(hits);
+           hits &= hits - 1;
+           if (__teddy_verify(m, buf, len, pos + k, buckets[k], on_match, ctx, matches)) {
+               *stop = 1;
+               return pos;
+           }
+       }
+   }
+   return pos;
+}
+#endif
+
+static long __teddy_scan(const PatternMatcher *m, const unsigned char *buf, size_t len,
+                         PatternMatchFunc on_match, void *ctx)
+{
+   long matches = 0;
+   size_t pos = 0;
+#ifdef PATTERN_X86_DISPATCH
+   if (m->ssse3) {
+       int stop = 0;
+       pos = __teddy_scan_ssse3(m, buf, len, on_match, ctx, &matches, &stop);
+       if (stop) {
+           return matches;
+       }
+   }
+#endif
+   for (; pos + m->width <= len; pos++) {
+       unsigned int bits = 0xff;
+       for (int j = 0; j < m->width && bits; j++) {
+           bits &= __nibble_get(&m->masks[j], buf[pos + j]);
+       }
+       if (bits && __teddy_verify(m, buf, len, pos, bits, on_match, ctx, &matches)) {
+           break;
+       }
+   }
+   return matches;
+}
+
+/*
+ * Aho-Corasick
+ */
+struct TrieBuild {
+   uint32_t *first_child;
+   uint32_t *next_sibling;
+   unsigned char *byte;
+   uint32_t states;
+};
+
+static uint32_t __trie_child(const struct TrieBuild *t, uint32_t s, unsigned char c)
+{
+   for (uint32_t k = t->first_child[s]; k != PATTERN_NONE; k = t->next_sibling[k]) {
+       if (t->byte[k] == c) {
+           return k;
+       }
+   }
+   return PATTERN_NONE;
+}
+
+static uint32_t __sparse_child(const PatternMatcher *m, uint32_t s, unsigned char c)
+{
+   for (uint32_t e = m->edge_start[s]; e < m->edge_start[s + 1]; e++) {
+       if (m->edge_byte[e] == c) {
+           return m->edge_next[e];
+       }
+   }
+   return PATTERN_NONE;
+}
+
+static uint32_t __ac_step(const PatternMatcher *m, uint32_t s, unsigned char c)
+{
+   if (m->dfa) {
+       return m->dfa[(size_t)s * m->class_count + m->classes[c]];
+   }
+   for (;;) {
+       uint32_t next = __sparse_child(m, s, c);
+       if (next != PATTERN_NONE) {
+           return next;
+       }
+       if (s == 0) {
+           return 0;
+       }
+       s = m->fail[s];
+   }
+}
+
+static int __ac_build(PatternMatcher *m, size_t total)
+{
+   uint32_t cap = (uint32_t)total + 1;
+   struct TrieBuild t = { malloc(sizeof(uint32_t) * cap), malloc(sizeof(uint32_t) * cap),
+                          malloc(cap), 1 };
+   uint32_t *queue = malloc(sizeof(uint32_t) * cap);
+   m->fail = calloc(cap, sizeof(uint32_t));
+   m->term = malloc(sizeof(uint32_t) * cap);
+   m->dict = calloc(cap, sizeof(uint32_t));
+   m->pattern_next = malloc(sizeof(uint32_t) * (m->count + 1));
+   int ok = t.first_child && t.next_sibling && t.byte && queue && m->fail && m->term
+            && m->dict && m->pattern_next;
+   if (!ok) {
+       goto out;
+   }
+   t.first_child[0] = PATTERN_NONE;
+   m->term[0] = PATTERN_NONE;
+
+   /* Trie; patterns with identical bytes chain off one terminal state. */
+   for (int p = m->count - 1; p >= 0; p--) {
+       if (m->lengths[p] == 0) {
+           continue;
+       }
+       uint32_t s = 0;
+       const unsigned char *pat = __pattern(m, p);
+       for (size_t i = 0; i < m->lengths[p]; i++) {
+           uint32_t next = __trie_child(&t, s, pat[i]);
+           if (next == PATTERN_NONE) {
+               next = t.states++;
+               t.first_child[next] = PATTERN_NONE;
+               t.next_sibling[next] = t.first_child[s];
+               t.byte[next] = pat[i];
+               m->term[next] = PATTERN_NONE;
+               t.first_child[s] = next;
+           }
+           s = next;
+       }
+       m->pattern_next[p] = m->term[s];
+       m->term[s] = (uint32_t)p;
+   }
+   m->states = t.states;
+
+   /* Byte classes: each byte used by a pattern gets its own, the rest share 0. */
+   m->class_count = 1;
+   for (uint32_t s = 1; s < t.states; s++) {
+       if (!m->classes[t.byte[s]]) {
+           m->classes[t.byte[s]] = (unsigned char)m->class_count++;
+       }
+   }
+
+   /* Failure and dictionary links, breadth first. */
+   uint32_t head = 0, tail = 0;
+   for (uint32_t k = t.first_child[0]; k != PATTERN_NONE; k = t.next_sibling[k]) {
+       queue[tail++] = k;
+   }
+   while (head < tail) {
+       uint32_t s = queue[head++];
+       for (uint32_t k = t.first_child[s]; k != PATTERN_NONE; k = t.next_sibling[k]) {
+           uint32_t f = m->fail[s], next;
+           while ((next = __trie_child(&t, f, t.byte[k])) == PATTERN_NONE && f != 0) {
+               f = m->fail[f];
+           }
+           m->fail[k] = next == PATTERN_NONE ? 0 : next;
+           m->dict[k] = m->term[m->fail[k]] != PATTERN_NONE ? m->fail[k] : m->dict[m->fail[k]];
+           queue[tail++] = k;
+       }
+   }
+
+   /* Sparse edges sorted by byte. */
+   m->edge_start = malloc(sizeof(uint32_t) * (t.states + 1));
+   m->edge_byte = malloc(t.states);
+   m->edge_next = malloc(sizeof(uint32_t) * t.states);
+   if (!m->edge_start || !m->edge_byte || !m->edge_next) {
+       ok = 0;
+       goto out;
+   }
+   uint32_t edges = 0;
+   for (uint32_t s = 0; s < t.states; s++) {
+       m->edge_start[s] = edges;
+       for (uint32_t k = t.first_child[s]; k != PATTERN_NONE; k = t.next_sibling[k]) {
+           uint32_t e = edges++;
+           while (e > m->edge_start[s] && m->edge_byte[e - 1] > t.byte[k]) {
+               m->edge_byte[e] = m->edge_byte[e - 1];
+               m->edge_next[e] = m->edge_next[e - 1];
+               e--;
+           }
+           m->edge_byte[e] = t.byte[k];
+           m->edge_next[e] = k;
+       }
+   }
+   m->edge_start[t.states] = edges;
+
+   /* Root skip set. */
+   for (uint32_t e = m->edge_start[0]; e < m->edge_start[1]; e++) {
+       m->starts[m->edge_byte[e]] = 1;
+       __nibble_set(&m->start, m->edge_byte[e], 1);
+   }
+
+   /* Dense DFA, filled in BFS order so a state's failure row exists already. */
+   if ((size_t)t.states * m->class_count <= PATTERN_DFA_MAX_CELLS) {
+       m->dfa = malloc(sizeof(uint32_t) * t.states * m->class_count);
+   }
+   if (m->dfa) {
+       for (uint32_t c = 0; c < m->class_count; c++) {
+           m->dfa[c] = 0;
+       }
+       for (uint32_t e = m->edge_start[0]; e < m->edge_start[1]; e++) {
+           m->dfa[m->classes[m->edge_byte[e]]] = m->edge_next[e];
+       }
+       for (uint32_t i = 0; i < tail; i++) {
+           uint32_t s = queue[i];
+           uint32_t *row = m->dfa + (size_t)s * m->class_count;
+           memcpy(row, m->dfa + (size_t)m->fail[s] * m->class_count,
+                  sizeof(uint32_t) * m->class_count);
+           for (uint32_t e = m->edge_start[s]; e < m->edge_start[s + 1]; e++) {
+               row[m->classes[m->edge_byte[e]]] = m->edge_next[e];
+           }
+       }
+   }
+
+out:
+   free(t.first_child);
+   free(t.next_sibling);
+   free(t.byte);
+   free(queue);
+   return ok;
+}
+
+#ifdef PATTERN_X86_DISPATCH
+/* Skip whole 16-byte windows with no byte that may start a pattern. */
+__attribute__((target("ssse3")))
+static size_t __ac_skip_ssse3(const PatternMatcher *m, const unsigned char *buf, size_t len,
+                              size_t pos)
+{
+   for (; pos + 16 <= len; pos += 16) {
+       __m128i hit = __nibble_lookup(&m->start, _mm_loadu_si128((const __m128i *)(buf + pos)));
+       unsigned int hits = ~_mm_movemask_epi8(_mm_cmpeq_epi8(hit, _mm_setzero_si128())) & 0xffff;
+       while (hits) {
+           size_t k = pos + __builtin_ctz(hits);
+           if (m->starts[buf[k]]) {
+               return k;
+           }
+           hits &= hits - 1;
+       }
+   }
+   return pos;
+}
+#endif
+
+/* Next position at or after 'pos' whose byte can leave the root. */
+static size_t __ac_skip(const PatternMatcher *m, const unsigned char *buf, size_t len, size_t pos)
+{
+#ifdef PATTERN_X86_DISPATCH
+   if (m->ssse3) {
+       pos = __ac_skip_ssse3(m, buf, len, pos);
+   }
+#endif
+   while (pos < len && !m->starts[buf[pos]]) {
+       pos++;
+   }
+   return pos;
+}
+
+static long __ac_scan(const PatternMatcher *m, const unsigned char *buf, size_t len,
+                      PatternMatchFunc on_match, void *ctx)
+{
+   long matches = 0;
+   uint32_t s = 0;
+   for (size_t pos = 0; pos < len; pos++) {
+       if (s == 0) {
+           pos = __ac_skip(m, buf, len, pos);
+           if (pos == len) {
+               break;
+           }
+       }
+       s = __ac_step(m, s, buf[pos]);
+       uint32_t out = m->term[s] != PATTERN_NONE ? s : m->dict[s];
+       for (; out; out = m->dict[out]) {
+           for (uint32_t p = m->term[out]; p != PATTERN_NONE; p = m->pattern_next[p]) {
+               matches++;
+               if (on_match((int)p, pos + 1 - m->lengths[p], ctx)) {
+                   return matches;
+               }
+           }
+       }
+   }
+   return matches;
+}
+
+PatternMatcher* pattern_matcher_build(const char *arr[], int size)
+{
+   PatternMatcher *m = calloc(1, sizeof(PatternMatcher));
+   if (!m) {
+       return NULL;
+   }
+   m->count = size > 0 ? size : 0;
+   m->offsets = malloc(sizeof(size_t) * (m->count + 1));
+   m->lengths = malloc(sizeof(size_t) * (m->count + 1));
+   size_t total = 0, shortest = SIZE_MAX;
+   int live = 0;
+   for (int p = 0; p < m->count; p++) {
+       size_t len = strlen(arr[p]);
+       total += len;
+       if (len > 0) {
+           live++;
+           shortest = len < shortest ? len : shortest;
+       }
+   }
+   m->data = malloc(total + 1);
+   if (!m->offsets || !m->lengths || !m->data || total >= UINT32_MAX) {
+       pattern_matcher_free(m);
+       return NULL;
+   }
+   size_t offset = 0;
+   for (int p = 0; p < m->count; p++) {
+       m->offsets[p] = offset;
+       m->lengths[p] = strlen(arr[p]);
+       memcpy(m->data + offset, arr[p], m->lengths[p]);
+       offset += m->lengths[p];
+   }
+#ifdef PATTERN_X86_DISPATCH
+   /* Pick the SSSE3 kernels on the CPU we run on, not the one we were built for. */
+   __builtin_cpu_init();
+   m->ssse3 = __builtin_cpu_supports("ssse3");
+#endif
+
+   int ok = live <= TEDDY_MAX_PATTERNS ? __teddy_build(m, live, shortest)
+                                       : __ac_build(m, total);
+   if (!ok) {
+       pattern_matcher_free(m);
+       return NULL;
+   }
+   return m;
+}
+
+long pattern_matcher_scan(const PatternMatcher *matcher, const void *buf, size_t len,
+                          PatternMatchFunc on_match, void *ctx)
+{
+   if (matcher->teddy) {
+       return matcher->bucket_start[TEDDY_BUCKETS] ? __teddy_scan(matcher, buf, len, on_match, ctx)
+                                                   : 0;
+   }
+   return __ac_scan(matcher, buf, len, on_match, ctx);
+}
+
+long pattern_matcher_scan_file(const PatternMatcher *matcher, const char *path,
+                               PatternMatchFunc on_match, void *ctx)
+{
+   int fd = open(path, O_RDONLY);
+   if (fd == -1) {
+       return -1;
+   }
+   struct stat st;
+   if (fstat(fd, &st) != 0) {
+       close(fd);
+       return -1;
+   }
+   size_t size = st.st_size;
+   if (size == 0) {
+       close(fd);
+       return 0;
+   }
+   void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (map == MAP_FAILED) {
+       return -1;
+   }
+#ifdef MADV_SEQUENTIAL
+   madvise(map, size, MADV_SEQUENTIAL);
+#endif
+   long matches = pattern_matcher_scan(matcher, map, size, on_match, ctx);
+   munmap(map, size);
+   return matches;
+}
+
+void pattern_matcher_free(PatternMatcher *matcher)
+{
+   free(matcher->data);
+   free(matcher->offsets);
+   free(matcher->lengths);
+   free(matcher->bucket_patterns);
+   free(matcher->dfa);
+   free(matcher->edge_start);
+   free(matcher->edge_byte);
+   free(matcher->edge_next);
+   free(matcher->fail);
+   free(matcher->term);
+   free(matcher->dict);
+   free(matcher->pattern_next);
+   free(matcher);
+}
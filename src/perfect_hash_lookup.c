@@ -0,0 +1,277 @@
+/*
+ * perfect_hash_lookup.c - Frozen perfect hash tables
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <lookup/perfect_hash_lookup.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PHT_BUCKET_SIZE       4             /* average keys per displacement bucket */
+#define PHT_MAX_DISPLACEMENT  (1u << 16)    /* tried per bucket */
+#define PHT_WORK_PER_KEY      64            /* displacements tried per key, in total */
+#define PHT_MAX_ATTEMPTS      5             /* each with a fresh seed and more slack */
+
+struct PhtKey {
+   uint64_t hash;
+   const char *key;
+   void *value;
+   uint32_t length;
+   uint32_t bucket;
+};
+
+/* Map the high 32 bits of 'hash' onto [0, n) without a division. */
+static uint32_t __fast_range(uint64_t hash, uint32_t n)
+{
+   return (uint32_t)(((hash >> 32) * (uint64_t)n) >> 32);
+}
+
+static uint64_t __mix64(uint64_t x)
+{
+   x ^= x >> 33;
+   x *= 0xff51afd7ed558ccdULL;
+   x ^= x >> 33;
+   x *= 0xc4ceb9fe1a85ec53ULL;
+   x ^= x >> 33;
+   return x;
+}
+
+static uint32_t __pht_slot(uint64_t hash, uint32_t displacement, uint32_t slots)
+{
+   return __fast_range(__mix64(hash ^ (displacement * 0x9e3779b97f4a7c15ULL)), slots);
+}
+
+/* Zero marks an empty entry, so no key may hash to it. */
+static uint64_t __pht_hash(const char *key, size_t len, uint64_t seed)
+{
+   uint64_t hash = lookup_hash64(key, len, seed);
+   return hash ? hash : 1;
+}
+
+/*
+ * Find a displacement for every bucket, largest buckets first, such that
+ * all keys land on distinct slots out of 'slot_count'. 'members' holds key
+ * indexes grouped by bucket, 'start' the bucket boundaries within it.
+ * Gives up once 'budget' displacements have been tried in total.
+ */
+static int __pht_displace(const struct PhtKey *keys, uint32_t slot_count, uint32_t buckets,
+                          const uint32_t *members, const uint32_t *start,
+                          uint32_t *displacements, uint32_t *slots, uint64_t budget)
+{
+   uint32_t largest = 0;
+   for (uint32_t b = 0; b < buckets; b++) {
+       if (start[b + 1] - start[b] > largest) {
+           largest = start[b + 1] - start[b];
+       }
+   }
+   unsigned char *taken = calloc(slot_count, 1);
+   uint32_t *chosen = malloc(sizeof(uint32_t) * (largest + 1));
+   if (!taken || !chosen) {
+       free(taken);
+       free(chosen);
+       return 0;
+   }
+
+   int placed = 1;
+   for (uint32_t size = largest; size > 0 && placed; size--) {
+       for (uint32_t b = 0; b < buckets && placed; b++) {
+           if (start[b + 1] - start[b] != size) {
+               continue;
+           }
+           placed = 0;
+           for (uint32_t d = 0; d < PHT_MAX_DISPLACEMENT && !placed && budget > 0; d++) {
+               budget--;
+               uint32_t k;
+               for (k = 0; k < size; k++) {
+                   uint32_t slot = __pht_slot(keys[members[start[b] + k]].hash, d, slot_count);
+                   if (taken[slot]) {
+                       break;
+                   }
+                   taken[slot] = 1;
+                   chosen[k] = slot;
+               }
+               if (k == size) {
+                   placed = 1;
+                   displacements[b] = d;
+                   for (k = 0; k < size; k++) {
+                       slots[members[start[b] + k]] = chosen[k];
+                   }
+               } else {
+                   while (k-- > 0) {
+                       taken[chosen[k]] = 0;
+                   }
+               }
+           }
+       }
+   }
+   free(taken);
+   free(chosen);
+   return placed;
+}
+
+static PerfectHashTable* __pht_build(struct PhtKey *keys, uint32_t count, size_t key_bytes)
+{
+   uint32_t buckets = count / PHT_BUCKET_SIZE + 1;
+   uint32_t *start = calloc(buckets + 1, sizeof(uint32_t));
+   uint32_t *members = malloc(sizeof(uint32_t) * (count + 1));
+   uint32_t *slots = malloc(sizeof(uint32_t) * (count + 1));
+   uint32_t *displacements = calloc(buckets, sizeof(uint32_t));
+   PerfectHashTable *table = NULL;
+   if (!start || !members || !slots || !displacements) {
+       goto out;
+   }
+
+   /*
+    * A few spare slots keep the last buckets placeable: with one slot per
+    * key, a singleton bucket placed when almost all slots are taken needs
+    * about 'count' tries. Every failed attempt doubles the slack, starting
+    * from 1/32 (a load factor of about 0.97).
+    */
+   for (int attempt = 0; attempt < PHT_MAX_ATTEMPTS && !table; attempt++) {
+       uint64_t seed = lookup_hash_seed();
+       uint64_t slot_count = (uint64_t)count + (count >> (5 - attempt)) + 1;
+       if (slot_count > UINT32_MAX) {
+           break;
+       }
+
+       /* Group keys by bucket with a counting sort. */
+       memset(start, 0, sizeof(uint32_t) * (buckets + 1));
+       for (uint32_t i = 0; i < count; i++) {
+           keys[i].hash = __pht_hash(keys[i].key, keys[i].length, seed);
+           keys[i].bucket = __fast_range(keys[i].hash, buckets);
+           start[keys[i].bucket + 1]++;
+       }
+       for (uint32_t b = 0; b < buckets; b++) {
+           start[b + 1] += start[b];
+       }
+       for (uint32_t i = 0; i < count; i++) {
+           members[start[keys[i].bucket]++] = i;
+       }
+       for (uint32_t b = buckets; b > 0; b--) {
+           start[b] = start[b - 1];
+       }
+       start[0] = 0;
+
+       memset(displacements, 0, sizeof(uint32_t) * buckets);
+       uint64_t budget = (uint64_t)count * PHT_WORK_PER_KEY + PHT_MAX_DISPLACEMENT;
+       if (!__pht_displace(keys, (uint32_t)slot_count, buckets, members, start,
+                           displacements, slots, budget)) {
+           continue;
+       }
+
+       /* One block: header, displacements, entries, key bytes. */
+       size_t disp_size = (sizeof(uint32_t) * buckets + 7) & ~(size_t)7;
+       size_t header = (sizeof(PerfectHashTable) + 7) & ~(size_t)7;
+       table = malloc(header + disp_size + sizeof(PerfectHashEntry) * slot_count + key_bytes);
+       if (!table) {
+           break;
+       }
+       uint32_t *disp_out = (uint32_t *)((char *)table + header);
+       PerfectHashEntry *entries = (PerfectHashEntry *)((char *)disp_out + disp_size);
+       char *key_data = (char *)(entries + slot_count);
+       memcpy(disp_out, displacements, sizeof(uint32_t) * buckets);
+       memset(entries, 0, sizeof(PerfectHashEntry) * slot_count);
+
+       size_t offset = 0;
+       for (uint32_t i = 0; i < count; i++) {
+           PerfectHashEntry *entry = &entries[slots[i]];
+           entry->hash = keys[i].hash;
+           entry->key_offset = (uint32_t)offset;
+           entry->key_length = keys[i].length;
+           entry->value = keys[i].value;
+           memcpy(key_data + offset, keys[i].key, keys[i].length + 1);
+           offset += keys[i].length + 1;
+       }
+       table->seed = seed;
+       table->count = count;
+       table->slots = (uint32_t)slot_count;
+       table->buckets = buckets;
+       table->displacements = disp_out;
+       table->entries = entries;
+       table->key_data = key_data;
+   }
+
+out:
+   free(start);
+   free(members);
+   free(slots);
+   free(displacements);
+   return table;
+}
+
+static void __collect(const HashTable *table, struct PhtKey *keys, uint32_t *count,
+                      size_t *key_bytes)
+{
+   for (int i = 0; i < table->capacity; i++) {
+       if (!table->keys[i]) {
+           continue;
+       }
+       struct PhtKey *k = &keys[(*count)++];
+       k->key = table->keys[i];
+       k->value = table->values[i];
+       k->length = strlen(k->key);
+       *key_bytes += k->length + 1;
+   }
+}
+
+PerfectHashTable* hash_table_freeze(HashTable *table)
+{
+   if (table->image) {
+       return NULL;  // a mapped image is already frozen
+   }
+   struct PhtKey *keys = malloc(sizeof(struct PhtKey) * (table->size + 1));
+   if (!keys) {
+       return NULL;
+   }
+   uint32_t count = 0;
+   size_t key_bytes = 0;
+   __collect(table, keys, &count, &key_bytes);
+   if (table->old) {
+       __collect(table->old, keys, &count, &key_bytes);
+   }
+
+   PerfectHashTable *frozen = NULL;
+   if (key_bytes <= UINT32_MAX) {
+       frozen = __pht_build(keys, count, key_bytes);
+   }
+   free(keys);
+   return frozen;
+}
+
+int perfect_hash_lookup(const PerfectHashTable *table, const char *key, void **value)
+{
+   if (table->count == 0) {
+       return 0;
+   }
+   size_t len = strlen(key);
+   uint64_t hash = __pht_hash(key, len, table->seed);
+   uint32_t displacement = table->displacements[__fast_range(hash, table->buckets)];
+   const PerfectHashEntry *entry = &table->entries[__pht_slot(hash, displacement, table->slots)];
+   if (entry->hash == hash && entry->key_length == len
+       && memcmp(table->key_data + entry->key_offset, key, len) == 0) {
+       *value = entry->value;
+       return 1;  // Found
+   }
+   return 0;  // Not found
+}
+
+void perfect_hash_table_free(PerfectHashTable *table)
+{
+   free(table);
+}
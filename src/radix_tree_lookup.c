@@ -0,0 +1,450 @@
+/*
+ * radix_tree_lookup.c - Adaptive radix tree string index
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <lookup/radix_tree_lookup.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define RADIX_ARENA_CHUNK     (64 * 1024)
+#define RADIX_ALIGN           8
+
+enum { RADIX_NODE4, RADIX_NODE16, RADIX_NODE48, RADIX_NODE256 };
+
+/* Leaves are tagged in the low pointer bit. */
+#define RADIX_IS_LEAF(p)      ((uintptr_t)(p) & 1)
+#define RADIX_LEAF(p)         ((const struct RadixLeaf *)((uintptr_t)(p) & ~(uintptr_t)1))
+#define RADIX_TAG_LEAF(p)     ((void *)((uintptr_t)(p) | 1))
+
+struct RadixArena {
+   struct RadixArena *next;
+   size_t size;
+   size_t used;
+   char data[];
+};
+
+struct RadixLeaf {
+   const char *key;
+   size_t length;
+   int index;
+};
+
+struct RadixNode {
+   uint8_t type;
+   uint16_t count;
+   uint32_t prefix_len;
+   const unsigned char *prefix;
+};
+
+struct RadixNode4 {
+   struct RadixNode n;
+   unsigned char keys[4];
+   void *children[4];
+};
+
+struct RadixNode16 {
+   struct RadixNode n;
+   unsigned char keys[16];
+   void *children[16];
+};
+
+struct RadixNode48 {
+   struct RadixNode n;
+   unsigned char child_index[256];   /* slot + 1, 0 if absent */
+   void *children[48];
+};
+
+struct RadixNode256 {
+   struct RadixNode n;
+   void *children[256];
+};
+
+struct RadixKey {
+   const char *key;
+   int index;
+};
+
+static void* __arena_alloc(struct RadixArena **arena, size_t size)
+{
+   size = (size + RADIX_ALIGN - 1) & ~(size_t)(RADIX_ALIGN - 1);
+   struct RadixArena *chunk = *arena;
+   if (!chunk || chunk->size - chunk->used < size) {
+       size_t chunk_size = size > RADIX_ARENA_CHUNK ? size : RADIX_ARENA_CHUNK;
+       chunk = malloc(sizeof(struct RadixArena) + chunk_size);
+       if (!chunk) {
+           return NULL;
+       }
+       chunk->next = *arena;
+       chunk->size = chunk_size;
+       chunk->used = 0;
+       *arena = chunk;
+   }
+   void *p = chunk->data + chunk->used;
+   chunk->used += size;
+   return p;
+}
+
+static void __arena_free(struct RadixArena *arena)
+{
+   while (arena) {
+       struct RadixArena *next = arena->next;
+       free(arena);
+       arena = next;
+   }
+}
+
+static int __radix_key_cmp(const void *a, const void *b)
+{
+   const struct RadixKey *x = a, *y = b;
+   int cmp = strcmp(x->key, y->key);
+   return cmp ? cmp : (x->index > y->index) - (x->index < y->index);
+}
+
+static void* __find_child(const struct RadixNode *node, unsigned char c)
+{
+   switch (node->type) {
+   case RADIX_NODE4: {
+       const struct RadixNode4 *n = (const struct RadixNode4 *)node;
+       for (int i = 0; i < node->count; i++) {
+           if (n->keys[i] == c) {
+               return n->children[i];
+           }
+       }
+       return NULL;
+   }
+   case RADIX_NODE16: {
+       const struct RadixNode16 *n = (const struct RadixNode16 *)node;
+#if defined(__SSE2__)
+       __m128i eq = _mm_cmpeq_epi8(_mm_set1_epi8((char)c),
+                                   _mm_loadu_si128((const __m128i *)n->keys));
+       unsigned int mask = _mm_movemask_epi8(eq) & ((1u << node->count) - 1);
+       return mask ? n->children[__builtin_ctz(mask)] : NULL;
+#else
+       for (int i = 0; i < node->count; i++) {
+           if (n->keys[i] == c) {
+               return n->children[i];
+           }
+       }
+       return NULL;
+#endif
+   }
+   case RADIX_NODE48: {
+       const struct RadixNode48 *n = (const struct RadixNode48 *)node;
+       return n->child_index[c] ? n->children[n->child_index[c] - 1] : NULL;
+   }
+   default:
+       return ((const struct RadixNode256 *)node)->children[c];
+   }
+}
+
+/*
+ * Build the subtree for the sorted, distinct keys [lo, hi) that agree on
+ * their first 'depth' bytes.
+ */
+static void* __radix_build(struct RadixArena **arena, const struct RadixKey *keys, int lo,
+                           int hi, size_t depth)
+{
+   if (hi - lo == 1) {
+       struct RadixLeaf *leaf = __arena_alloc(arena, sizeof(struct RadixLeaf));
+       if (!leaf) {
+           return NULL;
+       }
+       leaf->key = keys[lo].key;
+       leaf->length = strlen(keys[lo].key);
+       leaf->index = keys[lo].index;
+       return RADIX_TAG_LEAF(leaf);
+   }
+
+   /* In sorted order the first and last keys bound the shared prefix. */
+   const unsigned char *first = (const unsigned char *)keys[lo].key + depth;
+   const unsigned char *last = (const unsigned char *)keys[hi - 1].key + depth;
+   size_t prefix_len = 0;
+   while (first[prefix_len] == last[prefix_len]) {
+       prefix_len++;
+   }
+   size_t split = depth + prefix_len;
+
+   int groups = 0;
+   for (int i = lo; i < hi; i++) {
+       if (i == lo || keys[i].key[split] != keys[i - 1].key[split]) {
+           groups++;
+       }
+   }
+
+   struct RadixNode *node;
+   if (groups <= 4) {
+       node = __arena_alloc(arena, sizeof(struct RadixNode4));
+       if (node) {
+           node->type = RADIX_NODE4;
+       }
+   } else if (groups <= 16) {
+       node = __arena_alloc(arena, sizeof(struct RadixNode16));
+       if (node) {
+           node->type = RADIX_NODE16;
+           memset(((struct RadixNode16 *)node)->keys, 0, 16);
+       }
+   } else if (groups <= 48) {
+       node = __arena_alloc(arena, sizeof(struct RadixNode48));
+       if (node) {
+           node->type = RADIX_NODE48;
+           memset(((struct RadixNode48 *)node)->child_index, 0, 256);
+       }
+   } else {
+       node = __arena_alloc(arena, sizeof(struct RadixNode256));
+       if (node) {
+           node->type = RADIX_NODE256;
+           memset(((struct RadixNode256 *)node)->children, 0, sizeof(void *) * 256);
+       }
+   }
+   if (!node) {
+       return NULL;
+   }
+   node->count = 0;
+   node->prefix_len = (uint32_t)prefix_len;
+   node->prefix = first;  // key bytes already live in the arena
+
+   for (int start = lo; start < hi;) {
+       unsigned char c = (unsigned char)keys[start].key[split];
+       int end = start + 1;
+       while (end < hi && (unsigned char)keys[end].key[split] == c) {
+           end++;
+       }
+       void *child = __radix_build(arena, keys, start, end, split + 1);
+       if (!child) {
+           return NULL;
+       }
+       switch (node->type) {
+       case RADIX_NODE4:
+           ((struct RadixNode4 *)node)->keys[node->count] = c;
+           ((struct RadixNode4 *)node)->children[node->count] = child;
+           break;
+       case RADIX_NODE16:
+           ((struct RadixNode16 *)node)->keys[node->count] = c;
+           ((struct RadixNode16 *)node)->children[node->count] = child;
+           break;
+       case RADIX_NODE48:
+           ((struct RadixNode48 *)node)->child_index[c] = (unsigned char)(node->count + 1);
+           ((struct RadixNode48 *)node)->children[node->count] = child;
+           break;
+       default:
+           ((struct RadixNode256 *)node)->children[c] = child;
+           break;
+       }
+       node->count++;
+       start = end;
+   }
+   return node;
+}
+
+RadixTree* radix_tree_build(const char *arr[], int size)
+{
+   RadixTree *tree = calloc(1, sizeof(RadixTree));
+   struct RadixKey *keys = malloc(sizeof(struct RadixKey) * (size > 0 ? size : 1));
+   if (!tree || !keys) {
+       free(tree);
+       free(keys);
+       return NULL;
+   }
+   int count = 0;
+   for (int i = 0; i < size; i++) {
+       size_t len = strlen(arr[i]) + 1;
+       char *copy = __arena_alloc(&tree->arena, len);
+       if (!copy) {
+           free(keys);
+           radix_tree_free(tree);
+           return NULL;
+       }
+       memcpy(copy, arr[i], len);
+       keys[count].key = copy;
+       keys[count].index = i;
+       count++;
+   }
+   qsort(keys, count, sizeof(struct RadixKey), __radix_key_cmp);
+
+   /* Drop repeats, keeping the lowest original index. */
+   int unique = 0;
+   for (int i = 0; i < count; i++) {
+       if (unique == 0 || strcmp(keys[unique - 1].key, keys[i].key) != 0) {
+           keys[unique++] = keys[i];
+       }
+   }
+   tree->size = unique;
+   if (unique > 0) {
+       tree->root = __radix_build(&tree->arena, keys, 0, unique, 0);
+       if (!tree->root) {
+           free(keys);
+           radix_tree_free(tree);
+           return NULL;
+       }
+   }
+   free(keys);
+   return tree;
+}
+
+/* Length of the match between a node's compressed path and 'key'. */
+static size_t __prefix_match(const struct RadixNode *node, const unsigned char *key)
+{
+   size_t i = 0;
+   while (i < node->prefix_len && node->prefix[i] == key[i]) {
+       i++;
+   }
+   return i;
+}
+
+int radix_tree_lookup(const RadixTree *tree, const char *key)
+{
+   const unsigned char *k = (const unsigned char *)key;
+   const void *p = tree->root;
+   size_t depth = 0;
+   while (p && !RADIX_IS_LEAF(p)) {
+       const struct RadixNode *node = p;
+       if (__prefix_match(node, k + depth) != node->prefix_len) {
+           return -1;  // Not found
+       }
+       depth += node->prefix_len;
+       p = __find_child(node, k[depth]);
+       if (k[depth] == '\0') {
+           break;
+       }
+       depth++;
+   }
+   if (!p) {
+       return -1;  // Not found
+   }
+   const struct RadixLeaf *leaf = RADIX_LEAF(p);
+   return strcmp(leaf->key + depth, key + depth) == 0 ? leaf->index : -1;
+}
+
+int radix_tree_longest_prefix(const RadixTree *tree, const char *key)
+{
+   const unsigned char *k = (const unsigned char *)key;
+   const void *p = tree->root;
+   size_t depth = 0;
+   int best = -1;
+   while (p && !RADIX_IS_LEAF(p)) {
+       const struct RadixNode *node = p;
+       if (__prefix_match(node, k + depth) != node->prefix_len) {
+           return best;
+       }
+       depth += node->prefix_len;
+       /* A terminator child is the key spelled by the path so far. */
+       const void *end = __find_child(node, '\0');
+       if (end) {
+           best = RADIX_LEAF(end)->index;
+       }
+       if (k[depth] == '\0') {
+           return best;
+       }
+       p = __find_child(node, k[depth++]);
+   }
+   if (p) {
+       const struct RadixLeaf *leaf = RADIX_LEAF(p);
+       if (leaf->length >= depth
+           && strncmp(leaf->key + depth, key + depth, leaf->length - depth) == 0) {
+           best = leaf->index;
+       }
+   }
+   return best;
+}
+
+static int __radix_visit(const void *p, RadixTreeVisit visit, void *ctx, int *stop)
+{
+   if (RADIX_IS_LEAF(p)) {
+       const struct RadixLeaf *leaf = RADIX_LEAF(p);
+       *stop = visit(leaf->key, leaf->index, ctx);
+       return 1;
+   }
+   const struct RadixNode *node = p;
+   int visited = 0;
+   switch (node->type) {
+   case RADIX_NODE4:
+   case RADIX_NODE16: {
+       void *const *children = node->type == RADIX_NODE4
+                                   ? ((const struct RadixNode4 *)node)->children
+                                   : ((const struct RadixNode16 *)node)->children;
+       for (int i = 0; i < node->count && !*stop; i++) {
+           visited += __radix_visit(children[i], visit, ctx, stop);
+       }
+       break;
+   }
+   case RADIX_NODE48: {
+       const struct RadixNode48 *n = (const struct RadixNode48 *)node;
+       for (int c = 0; c < 256 && !*stop; c++) {
+           if (n->child_index[c]) {
+               visited += __radix_visit(n->children[n->child_index[c] - 1], visit, ctx, stop);
+           }
+       }
+       break;
+   }
+   default: {
+       const struct RadixNode256 *n = (const struct RadixNode256 *)node;
+       for (int c = 0; c < 256 && !*stop; c++) {
+           if (n->children[c]) {
+               visited += __radix_visit(n->children[c], visit, ctx, stop);
+           }
+       }
+       break;
+   }
+   }
+   return visited;
+}
+
+int radix_tree_prefix_each(const RadixTree *tree, const char *prefix, RadixTreeVisit visit,
+                           void *ctx)
+{
+   const unsigned char *k = (const unsigned char *)prefix;
+   const void *p = tree->root;
+   size_t depth = 0;
+   int stop = 0;
+   while (p && !RADIX_IS_LEAF(p) && k[depth] != '\0') {
+       const struct RadixNode *node = p;
+       size_t matched = __prefix_match(node, k + depth);
+       if (matched < node->prefix_len) {
+           /* Either the prefix ends inside the path, or they differ. */
+           return k[depth + matched] == '\0' ? __radix_visit(p, visit, ctx, &stop) : 0;
+       }
+       depth += node->prefix_len;
+       if (k[depth] == '\0') {
+           break;
+       }
+       p = __find_child(node, k[depth++]);
+   }
+   if (!p) {
+       return 0;
+   }
+   if (RADIX_IS_LEAF(p)) {
+       const struct RadixLeaf *leaf = RADIX_LEAF(p);
+       if (strncmp(leaf->key + depth, prefix + depth, strlen(prefix + depth)) != 0) {
+           return 0;
+       }
+   }
+   return __radix_visit(p, visit, ctx, &stop);
+}
+
+void radix_tree_free(RadixTree *tree)
+{
+   __arena_free(tree->arena);
+   free(tree);
+}
@@ -20,9 +20,27 @@
  */
 
 #include <lookup/string_lookup.h>
+#include <lookup/hash_lookup.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define STRING_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define STRING_PREFETCH(addr) ((void)(addr))
+#endif
+
+#define STRING_SEARCH_BATCH   16    /* queries descending in lockstep */
+#define STRING_SET_LANES      4     /* entries filtered per step */
+#define STRING_SET_PAD_LENGTH UINT32_MAX
+#define STRING_FOLD_STACK     256   /* targets folded without a heap buffer */
+#define STRING_FRONT_BLOCK    16    /* entries per front-coded block */
+
 /*
  * Case-sensitive and case-insensitive string lookup functions.
  */
@@ -66,3 +84,545 @@ int binary_search_string(const char *arr[], int size, const char *target)
    }
    return -1;
 }
+
+/*
+ * Batched binary search. Each level takes two passes over the group: the
+ * first loads every probe's string pointer (prefetched a level earlier)
+ * and prefetches the string bytes, the second compares and prefetches
+ * the next pointer slot.
+ */
+void binary_search_string_batch(const char *arr[], int size, const char *queries[], int count,
+                                int *out)
+{
+   const char **base[STRING_SEARCH_BATCH];
+   for (int start = 0; start < count; start += STRING_SEARCH_BATCH) {
+       int group = count - start < STRING_SEARCH_BATCH ? count - start : STRING_SEARCH_BATCH;
+       const char **q = queries + start;
+       if (size <= 0) {
+           for (int g = 0; g < group; g++) {
+               out[start + g] = -1;
+           }
+           continue;
+       }
+       for (int g = 0; g < group; g++) {
+           base[g] = arr;
+       }
+       int n = size;
+       while (n > 1) {
+           int half = n / 2;
+           for (int g = 0; g < group; g++) {
+               STRING_PREFETCH(base[g][half]);
+           }
+           for (int g = 0; g < group; g++) {
+               base[g] = strcmp(base[g][half], q[g]) < 0 ? base[g] + half : base[g];
+               STRING_PREFETCH(base[g] + (n - half) / 2);
+           }
+           n -= half;
+       }
+       for (int g = 0; g < group; g++) {
+           int idx = (int)(base[g] - arr) + (strcmp(*base[g], q[g]) < 0);
+           out[start + g] = idx < size && strcmp(arr[idx], q[g]) == 0 ? idx : -1;
+       }
+   }
+}
+
+struct StringQuery {
+   const char *value;
+   int index;
+};
+
+static int __string_query_cmp(const void *a, const void *b)
+{
+   return strcmp(((const struct StringQuery *)a)->value, ((const struct StringQuery *)b)->value);
+}
+
+/* Sorted-query mode: gallop forward from the previous answer. */
+void binary_search_string_batch_sorted(const char *arr[], int size, const char *queries[],
+                                       int count, int *out)
+{
+   struct StringQuery *sorted = malloc(sizeof(struct StringQuery) * (count + 1));
+   if (!sorted) {
+       binary_search_string_batch(arr, size, queries, count, out);
+       return;
+   }
+   for (int i = 0; i < count; i++) {
+       sorted[i].value = queries[i];
+       sorted[i].index = i;
+   }
+   qsort(sorted, count, sizeof(struct StringQuery), __string_query_cmp);
+
+   int lo = 0;
+   for (int i = 0; i < count; i++) {
+       const char *target = sorted[i].value;
+       int step = 1;
+       while (lo + step < size && strcmp(arr[lo + step], target) < 0) {
+           step *= 2;
+       }
+       int left = lo + step / 2, right = lo + step < size ? lo + step : size;
+       while (left < right) {
+           int mid = left + (right - left) / 2;
+           if (strcmp(arr[mid], target) < 0) {
+               left = mid + 1;
+           } else {
+               right = mid;
+           }
+       }
+       lo = left;
+       out[sorted[i].index] = lo < size && strcmp(arr[lo], target) == 0 ? lo : -1;
+   }
+   free(sorted);
+}
+
+/* First 8 bytes of a string of length 'len', zero padded, as one word. */
+static uint64_t __string_prefix(const char *str, size_t len)
+{
+   uint64_t prefix = 0;
+   memcpy(&prefix, str, len < sizeof(prefix) ? len : sizeof(prefix));
+   return prefix;
+}
+
+StringSet* string_set_build(const char *arr[], int size)
+{
+   StringSet *set = calloc(1, sizeof(StringSet));
+   if (!set) {
+       return NULL;
+   }
+   set->size = size > 0 ? size : 0;
+   /* Pad to whole SIMD steps with lengths no target can have. */
+   size_t slots = (set->size + STRING_SET_LANES - 1) / STRING_SET_LANES * STRING_SET_LANES;
+   size_t bytes = 0;
+   for (int i = 0; i < set->size; i++) {
+       bytes += strlen(arr[i]) + 1;
+   }
+   set->data = bytes <= UINT32_MAX ? malloc(bytes + 1) : NULL;
+   set->offsets = malloc(sizeof(uint32_t) * (slots + 1));
+   set->lengths = malloc(sizeof(uint32_t) * (slots + 1));
+   set->prefixes = malloc(sizeof(uint64_t) * (slots + 1));
+   if (!set->data || !set->offsets || !set->lengths || !set->prefixes) {
+       string_set_free(set);
+       return NULL;
+   }
+
+   size_t offset = 0;
+   for (size_t i = 0; i < slots; i++) {
+       if (i < (size_t)set->size) {
+           size_t len = strlen(arr[i]);
+           memcpy(set->data + offset, arr[i], len + 1);
+           set->offsets[i] = (uint32_t)offset;
+           set->lengths[i] = (uint32_t)len;
+           set->prefixes[i] = __string_prefix(arr[i], len);
+           offset += len + 1;
+       } else {
+           set->offsets[i] = 0;
+           set->lengths[i] = STRING_SET_PAD_LENGTH;
+           set->prefixes[i] = 0;
+       }
+   }
+   return set;
+}
+
+/* Bitmask of the STRING_SET_LANES entries at 'i' whose length and prefix match. */
+static unsigned int __string_set_filter(const StringSet *set, size_t i, uint32_t len,
+                                        uint64_t prefix)
+{
+#if defined(__SSE2__)
+   __m128i lengths = _mm_loadu_si128((const __m128i *)(set->lengths + i));
+   int len_mask = _mm_movemask_ps(_mm_castsi128_ps(
+       _mm_cmpeq_epi32(lengths, _mm_set1_epi32((int)len))));
+   if (!len_mask) {
+       return 0;
+   }
+   /* SSE2 has no 64-bit compare: AND each 32-bit half with its partner. */
+   __m128i needle = _mm_set1_epi64x((long long)prefix);
+   __m128i lo = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(set->prefixes + i)), needle);
+   __m128i hi = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(set->prefixes + i + 2)), needle);
+   lo = _mm_and_si128(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+   hi = _mm_and_si128(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+   int prefix_mask = _mm_movemask_pd(_mm_castsi128_pd(lo))
+                     | _mm_movemask_pd(_mm_castsi128_pd(hi)) << 2;
+   return (unsigned int)(len_mask & prefix_mask);
+#else
+   unsigned int mask = 0;
+   for (int k = 0; k < STRING_SET_LANES; k++) {
+       mask |= (unsigned int)(set->lengths[i + k] == len && set->prefixes[i + k] == prefix) << k;
+   }
+   return mask;
+#endif
+}
+
+int string_set_lookup(const StringSet *set, const char *target)
+{
+   size_t len = strlen(target);
+   if (len >= STRING_SET_PAD_LENGTH) {
+       return -1;
+   }
+   uint64_t prefix = __string_prefix(target, len);
+   for (size_t i = 0; i < (size_t)set->size; i += STRING_SET_LANES) {
+       unsigned int mask = __string_set_filter(set, i, (uint32_t)len, prefix);
+       while (mask) {
+           size_t k = i + __builtin_ctz(mask);
+           if (len <= sizeof(prefix)
+               || memcmp(set->data + set->offsets[k] + sizeof(prefix), target + sizeof(prefix),
+                         len - sizeof(prefix)) == 0) {
+               return (int)k;  // Found
+           }
+           mask &= mask - 1;
+       }
+   }
+   return -1;  // Not found
+}
+
+void string_set_free(StringSet *set)
+{
+   free(set->data);
+   free(set->offsets);
+   free(set->lengths);
+   free(set->prefixes);
+   free(set);
+}
+
+struct CaseFoldSlot {
+   uint64_t hash;     /* 0: empty */
+   uint32_t index;
+   uint32_t length;
+};
+
+static char __fold_byte(unsigned char c)
+{
+   if (c >= 'A' && c <= 'Z') {
+       return (char)(c + ('a' - 'A'));
+   }
+   return (char)(c < 0x80 ? c : tolower(c));
+}
+
+/* Case-fold 'len' bytes of 'src' into 'dst'. */
+static void __fold(const char *src, size_t len, char *dst)
+{
+   size_t i = 0;
+#if defined(__SSE2__)
+   const __m128i before_a = _mm_set1_epi8('A' - 1);
+   const __m128i after_z = _mm_set1_epi8('Z' + 1);
+   const __m128i delta = _mm_set1_epi8('a' - 'A');
+   for (; i + 16 <= len; i += 16) {
+       __m128i c = _mm_loadu_si128((const __m128i *)(src + i));
+       if (_mm_movemask_epi8(c)) {
+           /* Non-ASCII bytes compare as negative; fold this block per byte. */
+           for (size_t k = i; k < i + 16; k++) {
+               dst[k] = __fold_byte((unsigned char)src[k]);
+           }
+           continue;
+       }
+       __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, before_a), _mm_cmplt_epi8(c, after_z));
+       _mm_storeu_si128((__m128i *)(dst + i), _mm_add_epi8(c, _mm_and_si128(upper, delta)));
+   }
+#endif
+   for (; i < len; i++) {
+       dst[i] = __fold_byte((unsigned char)src[i]);
+   }
+}
+
+static uint64_t __fold_hash(const char *folded, size_t len, uint64_t seed)
+{
+   uint64_t hash = lookup_hash64(folded, len, seed);
+   return hash ? hash : 1;
+}
+
+CaseInsensitiveIndex* case_insensitive_index_build(const char *arr[], int size)
+{
+   CaseInsensitiveIndex *index = calloc(1, sizeof(CaseInsensitiveIndex));
+   if (!index) {
+       return NULL;
+   }
+   index->size = size > 0 ? size : 0;
+   size_t capacity = 16;
+   while (capacity < (size_t)index->size * 2) {
+       capacity *= 2;
+   }
+   size_t bytes = 0;
+   for (int i = 0; i < index->size; i++) {
+       bytes += strlen(arr[i]) + 1;
+   }
+   index->mask = (uint32_t)(capacity - 1);
+   index->seed = lookup_hash_seed();
+   index->data = bytes <= UINT32_MAX ? malloc(bytes + 1) : NULL;
+   index->offsets = malloc(sizeof(uint32_t) * (index->size + 1));
+   index->slots = calloc(capacity, sizeof(struct CaseFoldSlot));
+   if (!index->data || !index->offsets || !index->slots) {
+       case_insensitive_index_free(index);
+       return NULL;
+   }
+
+   size_t offset = 0;
+   for (int i = 0; i < index->size; i++) {
+       size_t len = strlen(arr[i]);
+       char *folded = index->data + offset;
+       __fold(arr[i], len, folded);
+       folded[len] = '\0';
+       index->offsets[i] = (uint32_t)offset;
+       offset += len + 1;
+
+       uint64_t hash = __fold_hash(folded, len, index->seed);
+       uint32_t pos = (uint32_t)hash & index->mask;
+       for (;;) {
+           struct CaseFoldSlot *slot = &index->slots[pos];
+           if (!slot->hash) {
+               slot->hash = hash;
+               slot->index = (uint32_t)i;
+               slot->length = (uint32_t)len;
+               break;
+           }
+           if (slot->hash == hash && slot->length == len
+               && memcmp(index->data + index->offsets[slot->index], folded, len) == 0) {
+               break;  // keep the first of equal strings
+           }
+           pos = (pos + 1) & index->mask;
+       }
+   }
+   return index;
+}
+
+int case_insensitive_index_lookup(const CaseInsensitiveIndex *index, const char *target)
+{
+   size_t len = strlen(target);
+   char stack[STRING_FOLD_STACK];
+   char *folded = len <= sizeof(stack) ? stack : malloc(len);
+   if (!folded) {
+       return -1;
+   }
+   __fold(target, len, folded);
+   uint64_t hash = __fold_hash(folded, len, index->seed);
+
+   int found = -1;
+   uint32_t pos = (uint32_t)hash & index->mask;
+   for (;;) {
+       const struct CaseFoldSlot *slot = &index->slots[pos];
+       if (!slot->hash) {
+           break;  // Not found
+       }
+       if (slot->hash == hash && slot->length == len
+           && memcmp(index->data + index->offsets[slot->index], folded, len) == 0) {
+           found = (int)slot->index;  // Found
+           break;
+       }
+       pos = (pos + 1) & index->mask;
+   }
+   if (folded != stack) {
+       free(folded);
+   }
+   return found;
+}
+
+void case_insensitive_index_free(CaseInsensitiveIndex *index)
+{
+   free(index->data);
+   free(index->offsets);
+   free(index->slots);
+   free(index);
+}
+
+/* First 8 bytes as a big-endian integer: integer order is strcmp order. */
+static uint64_t __string_key(const char *str)
+{
+   uint64_t key = 0;
+   for (int i = 0; i < 8; i++) {
+       key <<= 8;
+       if (*str) {
+           key |= (unsigned char)*str++;
+       }
+   }
+   return key;
+}
+
+static size_t __varint_put(unsigned char *out, size_t value)
+{
+   size_t n = 0;
+   while (value >= 0x80) {
+       out[n++] = (unsigned char)(value | 0x80);
+       value >>= 7;
+   }
+   out[n++] = (unsigned char)value;
+   return n;
+}
+
+static size_t __varint_get(const unsigned char **in)
+{
+   size_t value = 0;
+   int shift = 0;
+   while (**in & 0x80) {
+       value |= (size_t)(*(*in)++ & 0x7f) << shift;
+       shift += 7;
+   }
+   return value | (size_t)*(*in)++ << shift;
+}
+
+SortedStringIndex* sorted_string_index_build(const char *arr[], int size)
+{
+   SortedStringIndex *index = calloc(1, sizeof(SortedStringIndex));
+   if (!index) {
+       return NULL;
+   }
+   index->size = size > 0 ? size : 0;
+   size_t blocks = (index->size + STRING_FRONT_BLOCK - 1) / STRING_FRONT_BLOCK;
+   /* Worst case: no sharing, two varints per entry. */
+   size_t bound = 0;
+   for (int i = 0; i < index->size; i++) {
+       bound += strlen(arr[i]) + 2 * 10;
+   }
+   index->prefixes = malloc(sizeof(uint64_t) * (index->size + 1));
+   index->block_offsets = malloc(sizeof(size_t) * (blocks + 1));
+   index->blob = malloc(bound + 1);
+   if (!index->prefixes || !index->block_offsets || !index->blob) {
+       sorted_string_index_free(index);
+       return NULL;
+   }
+
+   size_t used = 0;
+   for (int i = 0; i < index->size; i++) {
+       size_t len = strlen(arr[i]);
+       index->prefixes[i] = __string_key(arr[i]);
+       if (i % STRING_FRONT_BLOCK == 0) {
+           index->block_offsets[i / STRING_FRONT_BLOCK] = used;
+           used += __varint_put(index->blob + used, len);
+           memcpy(index->blob + used, arr[i], len);
+           used += len;
+           continue;
+       }
+       size_t shared = 0;
+       while (arr[i][shared] && arr[i][shared] == arr[i - 1][shared]) {
+           shared++;
+       }
+       used += __varint_put(index->blob + used, shared);
+       used += __varint_put(index->blob + used, len - shared);
+       memcpy(index->blob + used, arr[i] + shared, len - shared);
+       used += len - shared;
+   }
+   unsigned char *shrunk = realloc(index->blob, used + 1);
+   if (shrunk) {
+       index->blob = shrunk;
+   }
+   return index;
+}
+
+/*
+ * Compare a block head with 'target'; '*common' receives the length of
+ * their shared prefix. The cursor is left on the block's second entry.
+ */
+static int __head_cmp(const unsigned char **p, const char *target, size_t *common)
+{
+   size_t len = __varint_get(p);
+   const unsigned char *head = *p;
+   const unsigned char *t = (const unsigned char *)target;
+   size_t i = 0;
+   while (i < len && head[i] == t[i]) {
+       i++;
+   }
+   *p += len;
+   *common = i;
+   if (i == len) {
+       return t[i] ? -1 : 0;
+   }
+   return head[i] < t[i] ? -1 : 1;
+}
+
+/*
+ * Walk entries from the head of block 'block', tracking how much of the
+ * target the current entry matches, until one equals or passes it.
+ */
+static int __front_coded_find(const SortedStringIndex *index, size_t block, const char *target)
+{
+   const unsigned char *t = (const unsigned char *)target;
+   const unsigned char *p = NULL;
+   size_t common = 0;
+   for (size_t pos = block * STRING_FRONT_BLOCK; pos < (size_t)index->size; pos++) {
+       if (pos % STRING_FRONT_BLOCK == 0) {
+           p = index->blob + index->block_offsets[pos / STRING_FRONT_BLOCK];
+           int cmp = __head_cmp(&p, target, &common);
+           if (cmp >= 0) {
+               return cmp == 0 ? (int)pos : -1;
+           }
+           continue;
+       }
+       size_t shared = __varint_get(&p);
+       size_t suffix_len = __varint_get(&p);
+       const unsigned char *suffix = p;
+       p += suffix_len;
+       if (shared < common) {
+           return -1;  // diverges upward where the previous entry still matched
+       }
+       if (shared > common) {
+           continue;   // same first mismatch as the previous entry: still below
+       }
+       size_t k = 0;
+       while (k < suffix_len && suffix[k] == t[common + k]) {
+           k++;
+       }
+       if (k == suffix_len) {
+           if (!t[common + k]) {
+               return (int)pos;  // Found
+           }
+       } else if (suffix[k] > t[common + k]) {
+           return -1;  // Not found
+       }
+       common += k;
+   }
+   return -1;  // Not found
+}
+
+int sorted_string_index_find(const SortedStringIndex *index, const char *target)
+{
+   if (index->size == 0) {
+       return -1;
+   }
+   uint64_t key = __string_key(target);
+
+   /* Entries sharing the target's inline prefix: [lo, hi). */
+   const uint64_t *base = index->prefixes;
+   int n = index->size;
+   while (n > 1) {
+       int half = n / 2;
+       STRING_PREFETCH(base + half / 2);
+       STRING_PREFETCH(base + half + half / 2);
+       base = base[half] < key ? base + half : base;
+       n -= half;
+   }
+   int lo = (int)(base - index->prefixes) + (*base < key);
+   if (lo == index->size || index->prefixes[lo] != key) {
+       return -1;  // Not found
+   }
+   if (strnlen(target, 8) < 8) {
+       return lo;  // the prefix held the whole string
+   }
+   base = index->prefixes + lo;
+   n = index->size - lo;
+   while (n > 1) {
+       int half = n / 2;
+       base = base[half] <= key ? base + half : base;
+       n -= half;
+   }
+   int hi = (int)(base - index->prefixes) + 1;
+
+   /* Start from the last block in the tie whose head is below the target. */
+   size_t first = lo / STRING_FRONT_BLOCK, last = (hi - 1) / STRING_FRONT_BLOCK;
+   size_t block = first;
+   size_t left = first + 1, right = last + 1;
+   while (left < right) {
+       size_t mid = left + (right - left) / 2;
+       const unsigned char *p = index->blob + index->block_offsets[mid];
+       size_t common;
+       if (__head_cmp(&p, target, &common) < 0) {
+           block = mid;
+           left = mid + 1;
+       } else {
+           right = mid;
+       }
+   }
+   return __front_coded_find(index, block, target);
+}
+
+void sorted_string_index_free(SortedStringIndex *index)
+{
+   free(index->prefixes);
+   free(index->block_offsets);
+   free(index->blob);
+   free(index);
+}
@@ -0,0 +1,246 @@
+/*
+ * array_search_test.c - Typed and parallel array searches against brute force
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Runs the size_t typed searches for every element type over sorted
+ * arrays of every length up to 70 (across all SIMD widths and tails) and
+ * a few large ones, with runs of duplicates and the type's extremes, and
+ * compares each answer with a linear scan of the same array: the first
+ * match for lookup and binary_search, the first element >= / > target
+ * for the bounds and their difference for equal_range. Targets are every
+ * element, its neighbours and the extremes; float and double also check
+ * that -0.0 finds 0.0 and that NaN finds nothing.
+ *
+ * The parallel scans run with small chunks and several threads over an
+ * unsorted array holding the target nowhere, once, or several times,
+ * placed at the ends and on either side of chunk boundaries, and must
+ * return the first occurrence each time.
+ *
+ * Usage: array_search_test
+ */
+
+#include <lookup/array_lookup.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const size_t large_sizes[] = { 255, 256, 257, 1000, 4097, 100003 };
+
+static long failures;
+
+static void __fail(const char *what, const char *type, size_t size, size_t got, size_t want)
+{
+   if (failures++ < 20) {
+       fprintf(stderr, "FAIL: %s_%s size %zu: got %lld, expected %lld\n",
+               what, type, size, (long long)got, (long long)want);
+   }
+}
+
+/*
+ * For one element type: fill sorted arrays and check every search
+ * against a linear reference. 'lo' and 'hi' are the extremes placed at
+ * both ends of every third array.
+ */
+#define CHECK_TYPED(sfx, T, lo, hi)                                                  \
+   static void __check_target_##sfx(const T *arr, size_t size, T target)            \
+   {                                                                                \
+      size_t first = ARRAY_NPOS, lower = size, upper = size;                        \
+      for (size_t i = size; i-- > 0; ) {                                            \
+         if (arr[i] == target) {                                                    \
+            first = i;                                                              \
+         }                                                                          \
+         if (!(arr[i] < target)) {                                                  \
+            lower = i;                                                              \
+         }                                                                          \
+         if (target < arr[i]) {                                                     \
+            upper = i;                                                              \
+         }                                                                          \
+      }                                                                             \
+      size_t got = array_lookup_##sfx(arr, size, target);                           \
+      if (got != first) {                                                           \
+         __fail("array_lookup", #sfx, size, got, first);                            \
+      }                                                                             \
+      got = array_binary_search_##sfx(arr, size, target);                           \
+      if (got != first) {                                                           \
+         __fail("array_binary_search", #sfx, size, got, first);                     \
+      }                                                                             \
+      got = array_lower_bound_##sfx(arr, size, target);                             \
+      if (got != lower) {                                                           \
+         __fail("array_lower_bound", #sfx, size, got, lower);                       \
+      }                                                                             \
+      got = array_upper_bound_##sfx(arr, size, target);                             \
+      if (got != upper) {                                                           \
+         __fail("array_upper_bound", #sfx, size, got, upper);                       \
+      }                                                                             \
+      size_t start = ARRAY_NPOS;                                                    \
+      got = array_equal_range_##sfx(arr, size, target, &start);                     \
+      if (got != upper - lower || start != lower) {                                 \
+         __fail("array_equal_range", #sfx, size, got, upper - lower);               \
+      }                                                                             \
+   }                                                                                \
+                                                                                    \
+   static void __check_size_##sfx(T *arr, size_t size, unsigned int *seed)          \
+   {                                                                                \
+      T value = (T)0;                                                               \
+      for (size_t i = 0; i < size; i++) {                                           \
+         value += (T)(rand_r(seed) % 3);  /* a third of the steps repeat */         \
+         arr[i] = value;                                                            \
+      }                                                                             \
+      if (size % 3 == 0 && size > 1) {                                              \
+         arr[0] = lo;                                                               \
+         arr[size - 1] = hi;                                                        \
+      }                                                                             \
+      __check_target_##sfx(arr, size, lo);                                          \
+      __check_target_##sfx(arr, size, hi);                                          \
+      for (size_t i = 0; i < size; i++) {                                           \
+         __check_target_##sfx(arr, size, arr[i]);                                   \
+         if (arr[i] > lo) {                                                         \
+            __check_target_##sfx(arr, size, (T)(arr[i] - 1));                       \
+         }                                                                          \
+         if (arr[i] < hi) {                                                         \
+            __check_target_##sfx(arr, size, (T)(arr[i] + 1));                       \
+         }                                                                          \
+         if (size > 1000) {                                                         \
+            i += size / 256 + rand_r(seed) % 16;  /* sample the large arrays */     \
+         }                                                                          \
+      }                                                                             \
+   }                                                                                \
+                                                                                    \
+   static void __check_##sfx(unsigned int *seed)                                    \
+   {                                                                                \
+      size_t max = large_sizes[sizeof(large_sizes) / sizeof(large_sizes[0]) - 1];   \
+      T *arr = malloc(sizeof(T) * max);                                             \
+      if (!arr) {                                                                   \
+         fprintf(stderr, "out of memory\n");                                        \
+         exit(1);                                                                   \
+      }                                                                             \
+      for (size_t size = 0; size <= 70; size++) {                                   \
+         __check_size_##sfx(arr, size, seed);                                       \
+      }                                                                             \
+      for (size_t s = 0; s < sizeof(large_sizes) / sizeof(large_sizes[0]); s++) {   \
+         __check_size_##sfx(arr, large_sizes[s], seed);                             \
+      }                                                                             \
+      free(arr);                                                                    \
+   }
+
+CHECK_TYPED(int, int, INT_MIN, INT_MAX)
+CHECK_TYPED(uint32, uint32_t, 0, UINT32_MAX)
+CHECK_TYPED(int64, int64_t, INT64_MIN, INT64_MAX)
+CHECK_TYPED(uint64, uint64_t, 0, UINT64_MAX)
+CHECK_TYPED(float, float, -FLT_MAX, FLT_MAX)
+CHECK_TYPED(double, double, -DBL_MAX, DBL_MAX)
+
+/* IEEE compares: -0.0 finds 0.0, NaN finds nothing. */
+static void __check_ieee(void)
+{
+   float f[] = { -1.0f, 0.0f, 0.0f, 2.5f };
+   double d[] = { -1.0, 0.0, 0.0, 2.5 };
+   if (array_lookup_float(f, 4, -0.0f) != 1 || array_binary_search_float(f, 4, -0.0f) != 1
+       || array_lookup_double(d, 4, -0.0) != 1 || array_binary_search_double(d, 4, -0.0) != 1) {
+      __fail("negative zero", "float/double", 4, 0, 1);
+   }
+   if (array_lookup_float(f, 4, NAN) != ARRAY_NPOS
+       || array_binary_search_float(f, 4, NAN) != ARRAY_NPOS
+       || array_lookup_double(d, 4, NAN) != ARRAY_NPOS
+       || array_binary_search_double(d, 4, NAN) != ARRAY_NPOS) {
+      __fail("NaN", "float/double", 4, 0, ARRAY_NPOS);
+   }
+}
+
+#define PAR_SIZE              (1 << 20)
+#define PAR_CHUNK             4096
+
+static void __check_par(unsigned int *seed)
+{
+   int *ints = malloc(sizeof(int) * PAR_SIZE);
+   float *floats = malloc(sizeof(float) * PAR_SIZE);
+   void **pointers = malloc(sizeof(void *) * PAR_SIZE);
+   if (!ints || !floats || !pointers) {
+      fprintf(stderr, "out of memory\n");
+      exit(1);
+   }
+   static char marker;
+   size_t spots[] = {
+      0, 1, PAR_CHUNK - 1, PAR_CHUNK, PAR_CHUNK + 1, 7 * PAR_CHUNK - 1,
+      PAR_SIZE / 2, PAR_SIZE - PAR_CHUNK, PAR_SIZE - 1
+   };
+   size_t spot_count = sizeof(spots) / sizeof(spots[0]);
+   for (int round = 0; round < 40; round++) {
+      for (size_t i = 0; i < PAR_SIZE; i++) {
+         ints[i] = 1 + rand_r(seed) % 1000000;
+         floats[i] = (float)ints[i];
+         pointers[i] = &ints[i];
+      }
+      /* Round 0 has no match; later rounds place one to three copies. */
+      size_t first = ARRAY_NPOS;
+      int copies = round == 0 ? 0 : 1 + round % 3;
+      for (int c = 0; c < copies; c++) {
+         size_t at = round < 10 ? spots[(round + c * 4) % spot_count]
+                                : (size_t)rand_r(seed) % PAR_SIZE;
+         ints[at] = -1;
+         floats[at] = -0.0f;
+         pointers[at] = &marker;
+         first = at < first ? at : first;
+      }
+      int threads = 1 + round % 6;
+      size_t got = int_array_lookup_par(ints, PAR_SIZE, -1, threads, PAR_CHUNK);
+      if (got != first) {
+         __fail("int_array_lookup_par", "int", PAR_SIZE, got, first);
+      }
+      got = float_array_lookup_par(floats, PAR_SIZE, 0.0f, threads, PAR_CHUNK);
+      if (got != first) {
+         __fail("float_array_lookup_par", "float", PAR_SIZE, got, first);
+      }
+      void *hit = pointer_array_lookup_par(pointers, PAR_SIZE, &marker, threads, PAR_CHUNK);
+      if (hit != (first == ARRAY_NPOS ? NULL : &marker)) {
+         __fail("pointer_array_lookup_par", "pointer", PAR_SIZE, hit != NULL, first != ARRAY_NPOS);
+      }
+   }
+   if (float_array_lookup_par(floats, PAR_SIZE, NAN, 4, PAR_CHUNK) != ARRAY_NPOS) {
+      __fail("float_array_lookup_par", "NaN", PAR_SIZE, 0, ARRAY_NPOS);
+   }
+   free(ints);
+   free(floats);
+   free(pointers);
+}
+
+int main(void)
+{
+   unsigned int seed = 2024;
+   __check_int(&seed);
+   __check_uint32(&seed);
+   __check_int64(&seed);
+   __check_uint64(&seed);
+   __check_float(&seed);
+   __check_double(&seed);
+   __check_ieee();
+   __check_par(&seed);
+
+   if (failures) {
+      fprintf(stderr, "%ld failures\n", failures);
+      return 1;
+   }
+   printf("ok\n");
+   return 0;
+}
@@ -0,0 +1,210 @@
+/*
+ * concurrent_hash_bench.c - Lookup scaling benchmark for ConcurrentHashTable
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Reports lookups/sec from 1 to N threads (doubling, plus N itself) for
+ * ConcurrentHashTable and, as the baseline it replaces, a HashTable
+ * behind one global mutex. Every thread looks up random keys of a
+ * prefilled table for a fixed time; with writers > 0, that many extra
+ * threads keep updating values meanwhile.
+ *
+ * The library is built without optimization by default; for meaningful
+ * numbers build it with e.g. make CFLAGS="-Wall -O2 -fPIC" bench.
+ *
+ * Usage: concurrent_hash_bench [max threads] [keys] [seconds per point] [writers]
+ */
+
+#include <lookup/concurrent_hash_lookup.h>
+#include <lookup/hash_lookup.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+struct BenchShared {
+   ConcurrentHashTable *concurrent;
+   HashTable *locked;
+   pthread_mutex_t lock;
+   char **keys;
+   int key_count;
+   atomic_int stop;
+};
+
+struct BenchThread {
+   struct BenchShared *shared;
+   unsigned int seed;
+   long ops;
+   pthread_t thread;
+};
+
+static void* __concurrent_reader(void *arg)
+{
+   struct BenchThread *t = arg;
+   struct BenchShared *shared = t->shared;
+   void *value;
+   while (!atomic_load_explicit(&shared->stop, memory_order_relaxed)) {
+       for (int i = 0; i < 64; i++) {
+           const char *key = shared->keys[rand_r(&t->seed) % shared->key_count];
+           t->ops += concurrent_hash_lookup(shared->concurrent, key, &value);
+       }
+   }
+   return NULL;
+}
+
+static void* __locked_reader(void *arg)
+{
+   struct BenchThread *t = arg;
+   struct BenchShared *shared = t->shared;
+   void *value;
+   while (!atomic_load_explicit(&shared->stop, memory_order_relaxed)) {
+       for (int i = 0; i < 64; i++) {
+           const char *key = shared->keys[rand_r(&t->seed) % shared->key_count];
+           pthread_mutex_lock(&shared->lock);
+           t->ops += hash_lookup(shared->locked, key, &value);
+           pthread_mutex_unlock(&shared->lock);
+       }
+   }
+   return NULL;
+}
+
+static void* __concurrent_writer(void *arg)
+{
+   struct BenchThread *t = arg;
+   struct BenchShared *shared = t->shared;
+   while (!atomic_load_explicit(&shared->stop, memory_order_relaxed)) {
+       int k = rand_r(&t->seed) % shared->key_count;
+       concurrent_hash_insert(shared->concurrent, shared->keys[k], (void *)(uintptr_t)(k + 1));
+       t->ops++;
+   }
+   return NULL;
+}
+
+static void* __locked_writer(void *arg)
+{
+   struct BenchThread *t = arg;
+   struct BenchShared *shared = t->shared;
+   while (!atomic_load_explicit(&shared->stop, memory_order_relaxed)) {
+       int k = rand_r(&t->seed) % shared->key_count;
+       pthread_mutex_lock(&shared->lock);
+       hash_insert(shared->locked, shared->keys[k], (void *)(uintptr_t)(k + 1));
+       pthread_mutex_unlock(&shared->lock);
+       t->ops++;
+   }
+   return NULL;
+}
+
+static double __now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Run 'readers' lookup threads and 'writers' update threads; returns lookups/sec. */
+static double __measure(struct BenchShared *shared, void *(*reader)(void *),
+                        void *(*writer)(void *), int readers, int writers, double seconds)
+{
+   struct BenchThread *threads = calloc(readers + writers, sizeof(struct BenchThread));
+   atomic_store(&shared->stop, 0);
+   for (int i = 0; i < readers + writers; i++) {
+       threads[i].shared = shared;
+       threads[i].seed = 0x9e3779b9u * (i + 1);
+       pthread_create(&threads[i].thread, NULL, i < readers ? reader : writer, &threads[i]);
+   }
+   double start = __now();
+   usleep((useconds_t)(seconds * 1e6));
+   atomic_store(&shared->stop, 1);
+   long lookups = 0;
+   for (int i = 0; i < readers + writers; i++) {
+       pthread_join(threads[i].thread, NULL);
+       if (i < readers) {
+           lookups += threads[i].ops;
+       }
+   }
+   double elapsed = __now() - start;
+   free(threads);
+   return lookups / elapsed;
+}
+
+int main(int argc, char **argv)
+{
+   long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+   int max_threads = argc > 1 ? atoi(argv[1]) : (cpus > 0 ? (int)cpus : 1);
+   int key_count = argc > 2 ? atoi(argv[2]) : 100000;
+   double seconds = argc > 3 ? atof(argv[3]) : 0.5;
+   int writers = argc > 4 ? atoi(argv[4]) : 0;
+   if (max_threads < 1 || key_count < 1 || seconds <= 0 || writers < 0) {
+       fprintf(stderr, "usage: %s [max threads] [keys] [seconds per point] [writers]\n",
+               argv[0]);
+       return 2;
+   }
+
+   struct BenchShared shared = { .key_count = key_count };
+   shared.keys = malloc(sizeof(char *) * key_count);
+   shared.concurrent = concurrent_hash_table_create(key_count);
+   shared.locked = hash_table_create(key_count);
+   pthread_mutex_init(&shared.lock, NULL);
+   if (!shared.keys || !shared.concurrent || !shared.locked) {
+       fprintf(stderr, "out of memory\n");
+       return 1;
+   }
+   for (int k = 0; k < key_count; k++) {
+       char key[32];
+       snprintf(key, sizeof(key), "bench-key-%d", k);
+       shared.keys[k] = strdup(key);
+       concurrent_hash_insert(shared.concurrent, key, (void *)(uintptr_t)(k + 1));
+       hash_insert(shared.locked, key, (void *)(uintptr_t)(k + 1));
+   }
+
+   printf("%d keys, %.2fs per point, %d writer threads, %ld online CPUs\n",
+          key_count, seconds, writers, cpus);
+   printf("%8s %18s %18s %8s\n", "threads", "concurrent/s", "mutex+HashTable/s", "scaling");
+   double base = 0;
+   for (int threads = 1; ; threads *= 2) {
+       if (threads > max_threads) {
+           threads = max_threads;
+       }
+       double concurrent = __measure(&shared, __concurrent_reader, __concurrent_writer,
+                                     threads, writers, seconds);
+       double locked = __measure(&shared, __locked_reader, __locked_writer,
+                                 threads, writers, seconds);
+       if (threads == 1) {
+           base = concurrent;
+       }
+       printf("%8d %18.0f %18.0f %7.2fx\n", threads, concurrent, locked, concurrent / base);
+       if (threads == max_threads) {
+           break;
+       }
+   }
+
+   for (int k = 0; k < key_count; k++) {
+       free(shared.keys[k]);
+   }
+   free(shared.keys);
+   concurrent_hash_table_free(shared.concurrent);
+   hash_table_free(shared.locked);
+   pthread_mutex_destroy(&shared.lock);
+   return 0;
+}
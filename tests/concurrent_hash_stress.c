@@ -0,0 +1,236 @@
+/*
+ * concurrent_hash_stress.c - Multi-threaded stress test for ConcurrentHashTable
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Writers insert, update and remove keys from ranges they own, keeping a
+ * private record of what each key should hold, while readers look up
+ * keys from every range. The table starts small, so the whole run goes
+ * through many online resizes and node reclamations.
+ *
+ * Checked while running: a value read for a key always belongs to that
+ * key, and the pinned keys, inserted up front and never removed, are
+ * never missing. Checked at the end: every key is present exactly when
+ * its writer left it present, with the last value it wrote, and the size
+ * matches. Exits non-zero on the first inconsistency.
+ *
+ * Usage: concurrent_hash_stress [writers] [readers] [keys per writer] [rounds]
+ */
+
+#include <lookup/concurrent_hash_lookup.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define STRESS_PINNED         1024
+#define STRESS_OPS_PER_KEY    8
+
+struct StressShared {
+   ConcurrentHashTable *table;
+   int writers;
+   int keys_per_writer;
+   atomic_int writers_done;
+   atomic_long failures;
+};
+
+struct StressWriter {
+   struct StressShared *shared;
+   int id;
+   uintptr_t *expected;    /* per key: 0 if absent, else the value last written */
+   pthread_t thread;
+};
+
+struct StressReader {
+   struct StressShared *shared;
+   unsigned int seed;
+   long lookups;
+   pthread_t thread;
+};
+
+static void __key_name(char *buf, size_t size, int writer, int key)
+{
+   snprintf(buf, size, "w%d-k%d", writer, key);
+}
+
+/* Values carry their key's global number above a 16-bit version. */
+static uintptr_t __value(int global_key, unsigned int version)
+{
+   return ((uintptr_t)(global_key + 1) << 16) | (version & 0xffff);
+}
+
+static void __fail(struct StressShared *shared, const char *what, const char *key)
+{
+   if (atomic_fetch_add(&shared->failures, 1) < 10) {
+       fprintf(stderr, "FAIL: %s (%s)\n", what, key);
+   }
+}
+
+static void* __writer(void *arg)
+{
+   struct StressWriter *w = arg;
+   struct StressShared *shared = w->shared;
+   unsigned int seed = 0x9e3779b9u * (w->id + 1);
+   char key[32];
+   long ops = (long)shared->keys_per_writer * STRESS_OPS_PER_KEY;
+   for (long op = 0; op < ops; op++) {
+       int k = rand_r(&seed) % shared->keys_per_writer;
+       int global_key = w->id * shared->keys_per_writer + k;
+       __key_name(key, sizeof(key), w->id, k);
+       if (rand_r(&seed) % 4 == 0) {
+           int removed = concurrent_hash_remove(shared->table, key);
+           if (removed != (w->expected[k] != 0)) {
+               __fail(shared, "remove result disagrees with the writer's record", key);
+           }
+           w->expected[k] = 0;
+       } else {
+           uintptr_t value = __value(global_key, (unsigned int)op);
+           if (!concurrent_hash_insert(shared->table, key, (void *)value)) {
+               __fail(shared, "insert failed", key);
+               continue;
+           }
+           w->expected[k] = value;
+       }
+   }
+   atomic_fetch_add(&shared->writers_done, 1);
+   return NULL;
+}
+
+static void* __reader(void *arg)
+{
+   struct StressReader *r = arg;
+   struct StressShared *shared = r->shared;
+   char key[32];
+   while (atomic_load(&shared->writers_done) < shared->writers) {
+       void *value;
+       if (rand_r(&r->seed) % 8 == 0) {
+           int k = rand_r(&r->seed) % STRESS_PINNED;
+           snprintf(key, sizeof(key), "pinned-%d", k);
+           if (!concurrent_hash_lookup(shared->table, key, &value)) {
+               __fail(shared, "pinned key missing", key);
+           } else if ((uintptr_t)value != (uintptr_t)k + 1) {
+               __fail(shared, "pinned key has a foreign value", key);
+           }
+       } else {
+           int writer = rand_r(&r->seed) % shared->writers;
+           int k = rand_r(&r->seed) % shared->keys_per_writer;
+           uintptr_t owner = (uintptr_t)(writer * shared->keys_per_writer + k) + 1;
+           __key_name(key, sizeof(key), writer, k);
+           if (concurrent_hash_lookup(shared->table, key, &value)
+               && ((uintptr_t)value >> 16) != owner) {
+               __fail(shared, "value belongs to another key", key);
+           }
+       }
+       r->lookups++;
+   }
+   return NULL;
+}
+
+static int __round(int writers, int readers, int keys_per_writer)
+{
+   struct StressShared shared = { .writers = writers, .keys_per_writer = keys_per_writer };
+   atomic_init(&shared.writers_done, 0);
+   atomic_init(&shared.failures, 0);
+   shared.table = concurrent_hash_table_create(1);
+   if (!shared.table) {
+       fprintf(stderr, "FAIL: cannot create table\n");
+       return 0;
+   }
+   char key[32];
+   for (int k = 0; k < STRESS_PINNED; k++) {
+       snprintf(key, sizeof(key), "pinned-%d", k);
+       concurrent_hash_insert(shared.table, key, (void *)((uintptr_t)k + 1));
+   }
+
+   struct StressWriter *w = calloc(writers, sizeof(struct StressWriter));
+   struct StressReader *r = calloc(readers, sizeof(struct StressReader));
+   for (int i = 0; i < writers; i++) {
+       w[i].shared = &shared;
+       w[i].id = i;
+       w[i].expected = calloc(keys_per_writer, sizeof(uintptr_t));
+       pthread_create(&w[i].thread, NULL, __writer, &w[i]);
+   }
+   for (int i = 0; i < readers; i++) {
+       r[i].shared = &shared;
+       r[i].seed = 0x85ebca6bu * (i + 1);
+       pthread_create(&r[i].thread, NULL, __reader, &r[i]);
+   }
+   long lookups = 0;
+   for (int i = 0; i < writers; i++) {
+       pthread_join(w[i].thread, NULL);
+   }
+   for (int i = 0; i < readers; i++) {
+       pthread_join(r[i].thread, NULL);
+       lookups += r[i].lookups;
+   }
+
+   /* Quiescent: the table must match the writers' records exactly. */
+   long live = STRESS_PINNED;
+   for (int i = 0; i < writers; i++) {
+       for (int k = 0; k < keys_per_writer; k++) {
+           void *value;
+           __key_name(key, sizeof(key), i, k);
+           int found = concurrent_hash_lookup(shared.table, key, &value);
+           if (found != (w[i].expected[k] != 0)
+               || (found && (uintptr_t)value != w[i].expected[k])) {
+               __fail(&shared, "final state disagrees with the writer's record", key);
+           }
+           live += found;
+       }
+       free(w[i].expected);
+   }
+   if (concurrent_hash_size(shared.table) != live) {
+       fprintf(stderr, "FAIL: size %d, expected %ld\n", concurrent_hash_size(shared.table), live);
+       atomic_fetch_add(&shared.failures, 1);
+   }
+   printf("%d writers, %d readers: %ld keys live, %ld concurrent lookups, %ld failures\n",
+          writers, readers, live, lookups, atomic_load(&shared.failures));
+
+   concurrent_hash_table_free(shared.table);
+   free(w);
+   free(r);
+   return atomic_load(&shared.failures) == 0;
+}
+
+int main(int argc, char **argv)
+{
+   int writers = argc > 1 ? atoi(argv[1]) : 4;
+   int readers = argc > 2 ? atoi(argv[2]) : 4;
+   int keys = argc > 3 ? atoi(argv[3]) : 4000;
+   int rounds = argc > 4 ? atoi(argv[4]) : 3;
+   if (writers < 1 || readers < 0 || keys < 1 || rounds < 1) {
+       fprintf(stderr, "usage: %s [writers] [readers] [keys per writer] [rounds]\n", argv[0]);
+       return 2;
+   }
+   ConcurrentHashTable *small = concurrent_hash_table_create(-1);
+   if (!small || !concurrent_hash_insert(small, "k", (void *)1)) {
+       fprintf(stderr, "FAIL: negative capacity\n");
+       return 1;
+   }
+   concurrent_hash_table_free(small);
+   for (int round = 0; round < rounds; round++) {
+       if (!__round(writers, readers, keys)) {
+           return 1;
+       }
+   }
+   printf("ok\n");
+   return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * exec_lookup_test.c - Consistency checks for the executable symbol lookups
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Looks this test binary up in itself. It defines one function and holds
+ * an undefined weak reference to another, which leaves an imported (UND)
+ * entry in both .dynsym and .symtab; the linker also defines the untyped
+ * _end in .symtab. By default the function and the import are found and
+ * _end is not. With EXEC_LOOKUP_DEFINED, in ExecImage and in both kinds
+ * of scan, the function and _end are found and the import is not. The
+ * lookups must give the same answers when .symtab is answered from a
+ * persistent index that the first pass builds and the second pass reads;
+ * that index must be created with the caller's umask.
+ *
+ * Usage: exec_lookup_test
+ */
+
+#include <lookup/exec_lookup.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#define DEFINED_SYMBOL        "exec_test_defined"
+#define IMPORTED_SYMBOL       "exec_test_imported"
+#define UNTYPED_SYMBOL        "_end"
+
+extern int exec_test_imported(void) __attribute__((weak));
+__asm__(".type exec_test_imported, @function");   /* typed like a real import */
+
+__attribute__((used, noinline)) int exec_test_defined(void)
+{
+   return exec_test_imported ? exec_test_imported() : 0;
+}
+
+static int failures;
+
+static void __expect(const char *what, const char *symbol, int got, int want)
+{
+   if (got != want) {
+       fprintf(stderr, "FAIL: %s(%s) = %d, expected %d\n", what, symbol, got, want);
+       failures++;
+   }
+}
+
+static int __on_file(const char *path, const int *found, int count, void *ctx)
+{
+   (void)path;
+   int *out = ctx;
+   for (int i = 0; i < count; i++) {
+       out[i] = found[i];
+   }
+   return 0;
+}
+
+static void __check_lookups(const char *self)
+{
+   const int defined = EXEC_LOOKUP_SYMTAB | EXEC_LOOKUP_DEFINED;
+   __expect("find_symbol_in_executable", DEFINED_SYMBOL,
+            find_symbol_in_executable(self, DEFINED_SYMBOL), 1);
+   __expect("find_symbol_in_executable", IMPORTED_SYMBOL,
+            find_symbol_in_executable(self, IMPORTED_SYMBOL), 1);
+   __expect("find_symbol_in_executable", UNTYPED_SYMBOL,
+            find_symbol_in_executable(self, UNTYPED_SYMBOL), -1);
+   __expect("find_symbol_in_executable_ex(0)", IMPORTED_SYMBOL,
+            find_symbol_in_executable_ex(self, IMPORTED_SYMBOL, 0), 1);
+   __expect("find_symbol_in_executable_ex(DEFINED)", IMPORTED_SYMBOL,
+            find_symbol_in_executable_ex(self, IMPORTED_SYMBOL, EXEC_LOOKUP_DEFINED), -1);
+   __expect("find_symbol_in_executable_ex(SYMTAB | DEFINED)", DEFINED_SYMBOL,
+            find_symbol_in_executable_ex(self, DEFINED_SYMBOL, defined), 1);
+   __expect("find_symbol_in_executable_ex(SYMTAB | DEFINED)", IMPORTED_SYMBOL,
+            find_symbol_in_executable_ex(self, IMPORTED_SYMBOL, defined), -1);
+   __expect("find_symbol_in_executable_ex(SYMTAB | DEFINED)", UNTYPED_SYMBOL,
+            find_symbol_in_executable_ex(self, UNTYPED_SYMBOL, defined), 1);
+}
+
+/* Remove 'dir' and its files, checking each file's permission bits. */
+static void __remove_dir(const char *dir, mode_t mode)
+{
+   DIR *d = opendir(dir);
+   if (d) {
+       struct dirent *entry;
+       char path[4096];
+       struct stat st;
+       while ((entry = readdir(d))) {
+           if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+               snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+               if (stat(path, &st) == 0 && (st.st_mode & 0777) != mode) {
+                   fprintf(stderr, "FAIL: %s has mode %o, expected %o\n", path,
+                           (unsigned)(st.st_mode & 0777), (unsigned)mode);
+                   failures++;
+               }
+               unlink(path);
+           }
+       }
+       closedir(d);
+   }
+   rmdir(dir);
+}
+
+int main(int argc, char **argv)
+{
+   (void)argc;
+   const char *self = argv[0];
+
+   __check_lookups(self);
+
+   char cache_dir[] = "/tmp/exec_lookup_test.XXXXXX";
+   if (!mkdtemp(cache_dir) || exec_lookup_set_cache_dir(cache_dir) != 1) {
+       fprintf(stderr, "FAIL: cannot set up cache directory\n");
+       return 1;
+   }
+   mode_t mask = umask(027);
+   __check_lookups(self);   /* builds the index */
+   __check_lookups(self);   /* answers from it */
+   umask(mask);
+   exec_lookup_set_cache_dir(NULL);
+   __remove_dir(cache_dir, 0640);
+
+   ExecImage *image = exec_image_open(self);
+   if (!image) {
+       fprintf(stderr, "FAIL: exec_image_open(%s)\n", self);
+       return 1;
+   }
+   ExecSymbol sym;
+   __expect("exec_image_find_symbol", DEFINED_SYMBOL,
+            exec_image_find_symbol(image, DEFINED_SYMBOL, &sym), 1);
+   __expect("exec_image_find_symbol", IMPORTED_SYMBOL,
+            exec_image_find_symbol(image, IMPORTED_SYMBOL, &sym), -1);
+   __expect("exec_image_find_symbol", UNTYPED_SYMBOL,
+            exec_image_find_symbol(image, UNTYPED_SYMBOL, &sym), 1);
+   exec_image_close(image);
+
+   /* Both kinds of scan must agree with the lookups under the same rule. */
+   const char *symbols[] = { DEFINED_SYMBOL, IMPORTED_SYMBOL, UNTYPED_SYMBOL };
+   for (int flags = 0; flags <= EXEC_SCAN_SYMTAB; flags += EXEC_SCAN_SYMTAB) {
+       ExecScanOptions options = { 1, 0, flags };
+       int found[3] = { -1, -1, -1 };
+       __expect("exec_scan_files", self,
+                (int)exec_scan_files(&self, 1, symbols, 3, &options, __on_file, found), 1);
+       for (int i = 0; i < 3; i++) {
+           int want = find_symbol_in_executable_ex(self, symbols[i],
+                                                   flags | EXEC_LOOKUP_DEFINED) == 1;
+           __expect(flags ? "exec_scan_files(SYMTAB)" : "exec_scan_files", symbols[i],
+                    found[i], want);
+       }
+   }
+
+   if (failures) {
+       return 1;
+   }
+   printf("ok\n");
+   return 0;
+}
@@ -0,0 +1,483 @@
+/*
+ * hash_table_test.c - HashTable checked against a reference model
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Drives a HashTable created at the minimum capacity through random
+ * inserts, updates, removals and re-inserts of a fixed key set, and after
+ * every operation checks the touched key against a plain array model. The
+ * whole key set is checked after every grow and at every step while a
+ * previous generation is still being migrated, so lookups, updates and
+ * removals are exercised on both sides of a migration. GroupHashTable
+ * goes through the same sequence, checked in full after every resize and
+ * every thousand steps. hash_insert_many() and hash_lookup_many() get
+ * batches of odd lengths that mix present, absent and repeated keys, on
+ * tables that are mid-migration, and must agree with the model.
+ * hash_table_freeze() snapshots tables of many sizes, some of them
+ * mid-migration, and the frozen table must hold exactly the model's keys
+ * and values after its source is gone. hash_table_save() images must
+ * reopen through hash_table_open_mmap() with the same contents, be
+ * created with the caller's umask, stay read-only, save again from the
+ * mapping, and be refused once truncated or with a damaged header.
+ * Absurd capacities must be refused rather than hang.
+ *
+ * Usage: hash_table_test
+ */
+
+#include <lookup/hash_lookup.h>
+#include <lookup/perfect_hash_lookup.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MODEL_KEYS            5000
+#define MODEL_STEPS           200000
+
+struct Model {
+   int present[MODEL_KEYS];
+   uintptr_t value[MODEL_KEYS];
+   int size;
+};
+
+static long failures;
+static char keys[MODEL_KEYS][24];
+
+static void __fail(const char *what, const char *key, long got, long want)
+{
+   if (failures++ < 20) {
+       fprintf(stderr, "FAIL: %s(%s): got %ld, expected %ld\n", what, key, got, want);
+   }
+}
+
+static void __check_key(HashTable *table, const struct Model *model, int k)
+{
+   void *value = NULL;
+   int found = hash_lookup(table, keys[k], &value);
+   if (found != model->present[k]) {
+       __fail("hash_lookup", keys[k], found, model->present[k]);
+   } else if (found && (uintptr_t)value != model->value[k]) {
+       __fail("hash_lookup value", keys[k], (long)(uintptr_t)value, (long)model->value[k]);
+   }
+}
+
+static void __check_all(HashTable *table, const struct Model *model)
+{
+   for (int k = 0; k < MODEL_KEYS; k++) {
+       __check_key(table, model, k);
+   }
+   if (table->size != model->size) {
+       __fail("size", "-", table->size, model->size);
+   }
+}
+
+static void __check_model(void)
+{
+   struct Model *model = calloc(1, sizeof(struct Model));
+   HashTable *table = hash_table_create(1);
+   if (!model || !table) {
+       fprintf(stderr, "FAIL: cannot create table\n");
+       exit(1);
+   }
+   unsigned int seed = 12345;
+   int capacity = table->capacity, grows = 0, migrating_steps = 0;
+   for (int step = 0; step < MODEL_STEPS; step++) {
+       /* Inserts win early so the table grows; later the key set churns. */
+       int k = rand_r(&seed) % MODEL_KEYS;
+       int op = rand_r(&seed) % (step < MODEL_STEPS / 4 ? 4 : 2);
+       if (op == 0) {
+           int removed = hash_remove(table, keys[k]);
+           if (removed != model->present[k]) {
+               __fail("hash_remove", keys[k], removed, model->present[k]);
+           }
+           model->size -= model->present[k];
+           model->present[k] = 0;
+       } else {
+           uintptr_t value = (uintptr_t)step + 1;
+           if (!hash_insert(table, keys[k], (void *)value)) {
+               __fail("hash_insert", keys[k], 0, 1);
+           }
+           model->size += !model->present[k];
+           model->present[k] = 1;
+           model->value[k] = value;
+       }
+       __check_key(table, model, k);
+       if (table->capacity != capacity) {
+           capacity = table->capacity;
+           grows++;
+           __check_all(table, model);
+       } else if (table->old) {
+           migrating_steps++;
+           __check_all(table, model);
+       }
+   }
+   __check_all(table, model);
+   if (grows < 8 || migrating_steps == 0) {
+       fprintf(stderr, "FAIL: %d grows, %d steps mid-migration\n", grows, migrating_steps);
+       failures++;
+   }
+   hash_table_free(table);
+   free(model);
+}
+
+static void __check_group_key(GroupHashTable *table, const struct Model *model, int k)
+{
+   void *value = NULL;
+   int found = group_hash_lookup(table, keys[k], &value);
+   if (found != model->present[k]) {
+       __fail("group_hash_lookup", keys[k], found, model->present[k]);
+   } else if (found && (uintptr_t)value != model->value[k]) {
+       __fail("group_hash_lookup value", keys[k], (long)(uintptr_t)value,
+              (long)model->value[k]);
+   }
+}
+
+static void __check_group_all(GroupHashTable *table, const struct Model *model)
+{
+   for (int k = 0; k < MODEL_KEYS; k++) {
+       __check_group_key(table, model, k);
+   }
+   if (table->size != model->size) {
+       __fail("group size", "-", table->size, model->size);
+   }
+}
+
+static void __check_group_model(void)
+{
+   struct Model *model = calloc(1, sizeof(struct Model));
+   GroupHashTable *table = group_hash_table_create(1);
+   if (!model || !table) {
+       fprintf(stderr, "FAIL: cannot create group table\n");
+       exit(1);
+   }
+   unsigned int seed = 54321;
+   int capacity = table->capacity;
+   for (int step = 0; step < MODEL_STEPS; step++) {
+       int k = rand_r(&seed) % MODEL_KEYS;
+       int op = rand_r(&seed) % (step < MODEL_STEPS / 4 ? 4 : 2);
+       if (op == 0) {
+           int removed = group_hash_remove(table, keys[k]);
+           if (removed != model->present[k]) {
+               __fail("group_hash_remove", keys[k], removed, model->present[k]);
+           }
+           model->size -= model->present[k];
+           model->present[k] = 0;
+       } else {
+           uintptr_t value = (uintptr_t)step + 1;
+           if (!group_hash_insert(table, keys[k], (void *)value)) {
+               __fail("group_hash_insert", keys[k], 0, 1);
+           }
+           model->size += !model->present[k];
+           model->present[k] = 1;
+           model->value[k] = value;
+       }
+       __check_group_key(table, model, k);
+       if (table->capacity != capacity || step % 1000 == 0) {
+           capacity = table->capacity;
+           __check_group_all(table, model);
+       }
+   }
+   __check_group_all(table, model);
+   group_hash_table_free(table);
+   free(model);
+}
+
+static void __check_batches(void)
+{
+   struct Model *model = calloc(1, sizeof(struct Model));
+   HashTable *table = hash_table_create(1);
+   const char *batch[MODEL_KEYS];
+   void *values[MODEL_KEYS];
+   int found[MODEL_KEYS], picked[MODEL_KEYS];
+   if (!model || !table) {
+       fprintf(stderr, "FAIL: cannot create table\n");
+       exit(1);
+   }
+   unsigned int seed = 999;
+   int migrating = 0;
+   for (int round = 0; round < 200; round++) {
+       int n = rand_r(&seed) % 97;
+       for (int i = 0; i < n; i++) {
+           picked[i] = rand_r(&seed) % MODEL_KEYS;
+           batch[i] = keys[picked[i]];
+           values[i] = (void *)(uintptr_t)(round * 100 + i + 1);
+       }
+       int inserted = hash_insert_many(table, batch, values, n);
+       if (inserted != n) {
+           __fail("hash_insert_many", "-", inserted, n);
+       }
+       for (int i = 0; i < n; i++) {
+           model->size += !model->present[picked[i]];
+           model->present[picked[i]] = 1;
+           model->value[picked[i]] = (uintptr_t)values[i];
+       }
+       /* A few single inserts leave a migration in progress for the lookups. */
+       for (int i = 0; i < 3; i++) {
+           int k = rand_r(&seed) % MODEL_KEYS;
+           hash_insert(table, keys[k], (void *)(uintptr_t)(k + 1));
+           model->size += !model->present[k];
+           model->present[k] = 1;
+           model->value[k] = k + 1;
+       }
+       migrating += table->old != NULL;
+
+       n = rand_r(&seed) % 97;
+       for (int i = 0; i < n; i++) {
+           picked[i] = rand_r(&seed) % MODEL_KEYS;
+           batch[i] = keys[picked[i]];
+       }
+       int expected = 0;
+       for (int i = 0; i < n; i++) {
+           expected += model->present[picked[i]];
+       }
+       int hits = hash_lookup_many(table, batch, n, values, found);
+       if (hits != expected) {
+           __fail("hash_lookup_many", "-", hits, expected);
+       }
+       for (int i = 0; i < n; i++) {
+           int k = picked[i];
+           if (found[i] != model->present[k]
+               || (found[i] && (uintptr_t)values[i] != model->value[k])
+               || (!found[i] && values[i] != NULL)) {
+               __fail("hash_lookup_many", keys[k], found[i], model->present[k]);
+           }
+       }
+   }
+   __check_all(table, model);
+   if (migrating == 0) {
+       fprintf(stderr, "FAIL: no batch ran mid-migration\n");
+       failures++;
+   }
+   hash_table_free(table);
+   free(model);
+}
+
+static void __check_freeze(void)
+{
+   static const int sizes[] = { 0, 1, 2, 3, 7, 17, 100, 1000, 4999, MODEL_KEYS };
+   int migrating = 0;
+   for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+       struct Model *model = calloc(1, sizeof(struct Model));
+       HashTable *table = hash_table_create(1);
+       if (!model || !table) {
+           fprintf(stderr, "FAIL: cannot create table\n");
+           exit(1);
+       }
+       for (int k = 0; k < sizes[s]; k++) {
+           hash_insert(table, keys[k], (void *)(uintptr_t)(k + 1));
+           model->present[k] = 1;
+           model->value[k] = k + 1;
+           model->size++;
+       }
+       for (int k = 0; k < sizes[s]; k += 3) {
+           hash_remove(table, keys[k]);
+           model->present[k] = 0;
+           model->size--;
+       }
+       /* Every other table keeps growing until it is mid-migration. */
+       for (int k = sizes[s]; s % 2 && k < MODEL_KEYS && !table->old; k++) {
+           hash_insert(table, keys[k], (void *)(uintptr_t)(k + 1));
+           model->present[k] = 1;
+           model->value[k] = k + 1;
+           model->size++;
+       }
+       migrating += table->old != NULL;
+       PerfectHashTable *frozen = hash_table_freeze(table);
+       hash_table_free(table);
+       if (!frozen) {
+           fprintf(stderr, "FAIL: hash_table_freeze of %d keys\n", sizes[s]);
+           exit(1);
+       }
+       if ((int)frozen->count != model->size) {
+           __fail("frozen count", "-", frozen->count, model->size);
+       }
+       for (int k = 0; k < MODEL_KEYS; k++) {
+           void *value = NULL;
+           int found = perfect_hash_lookup(frozen, keys[k], &value);
+           if (found != model->present[k]
+               || (found && (uintptr_t)value != model->value[k])) {
+               __fail("perfect_hash_lookup", keys[k], found, model->present[k]);
+           }
+       }
+       void *value;
+       if (perfect_hash_lookup(frozen, "", &value)) {
+           __fail("perfect_hash_lookup", "\"\"", 1, 0);
+       }
+       perfect_hash_table_free(frozen);
+       free(model);
+   }
+   if (migrating == 0) {
+       fprintf(stderr, "FAIL: no table was frozen mid-migration\n");
+       failures++;
+   }
+}
+
+static void __check_image(HashTable *image, const struct Model *model, const char *what)
+{
+   const char *batch[MODEL_KEYS];
+   void *values[MODEL_KEYS];
+   int found[MODEL_KEYS];
+   __check_all(image, model);
+   for (int k = 0; k < MODEL_KEYS; k++) {
+       batch[k] = keys[k];
+   }
+   hash_lookup_many(image, batch, MODEL_KEYS, values, found);
+   for (int k = 0; k < MODEL_KEYS; k++) {
+       if (found[k] != model->present[k]
+           || (found[k] && (uintptr_t)values[k] != model->value[k])) {
+           __fail(what, keys[k], found[k], model->present[k]);
+       }
+   }
+   if (hash_insert(image, keys[0], NULL) || hash_remove(image, keys[1])) {
+       __fail(what, "read-only", 1, 0);
+   }
+}
+
+/* Rewrite 'path' as its first 'size' bytes, with byte 'flip' inverted (-1: none). */
+static void __damage(const char *path, const char *copy, long size, long flip)
+{
+   FILE *in = fopen(path, "rb");
+   FILE *out = fopen(copy, "wb");
+   if (!in || !out) {
+       fprintf(stderr, "FAIL: cannot copy %s\n", path);
+       exit(1);
+   }
+   for (long i = 0; i < size; i++) {
+       int c = fgetc(in);
+       fputc(i == flip ? ~c & 0xff : c, out);
+   }
+   fclose(in);
+   fclose(out);
+}
+
+static void __check_save(void)
+{
+   struct Model *model = calloc(1, sizeof(struct Model));
+   HashTable *table = hash_table_create(1);
+   if (!model || !table) {
+       fprintf(stderr, "FAIL: cannot create table\n");
+       exit(1);
+   }
+   for (int k = 0; k < MODEL_KEYS; k += 2) {
+       hash_insert(table, keys[k], (void *)(uintptr_t)(k + 1));
+       model->present[k] = 1;
+       model->value[k] = k + 1;
+       model->size++;
+   }
+
+   char dir[] = "/tmp/hash_table_test.XXXXXX";
+   char path[64], resaved[64], damaged[64];
+   if (!mkdtemp(dir)) {
+       fprintf(stderr, "FAIL: cannot create a temporary directory\n");
+       exit(1);
+   }
+   snprintf(path, sizeof(path), "%s/table", dir);
+   snprintf(resaved, sizeof(resaved), "%s/resaved", dir);
+   snprintf(damaged, sizeof(damaged), "%s/damaged", dir);
+
+   mode_t mask = umask(027);
+   struct stat st;
+   if (!hash_table_save(table, path) || stat(path, &st) != 0) {
+       fprintf(stderr, "FAIL: hash_table_save(%s)\n", path);
+       exit(1);
+   }
+   umask(mask);
+   if ((st.st_mode & 0777) != 0640) {
+       __fail("hash_table_save mode", path, st.st_mode & 0777, 0640);
+   }
+   hash_table_free(table);
+
+   HashTable *image = hash_table_open_mmap(path);
+   if (!image) {
+       fprintf(stderr, "FAIL: hash_table_open_mmap(%s)\n", path);
+       exit(1);
+   }
+   __check_image(image, model, "mapped lookup");
+   if (!hash_table_save(image, resaved)) {
+       __fail("hash_table_save of a mapping", resaved, 0, 1);
+   }
+   hash_table_free(image);
+   image = hash_table_open_mmap(resaved);
+   if (!image) {
+       __fail("hash_table_open_mmap", resaved, 0, 1);
+   } else {
+       __check_image(image, model, "resaved lookup");
+       hash_table_free(image);
+   }
+
+   /* Truncated anywhere, or with a header byte flipped, the image is refused. */
+   long size = (long)st.st_size;
+   long cuts[] = { 0, 1, 64, size / 2, size - 1 };
+   for (size_t i = 0; i < sizeof(cuts) / sizeof(cuts[0]); i++) {
+       __damage(path, damaged, cuts[i], -1);
+       image = hash_table_open_mmap(damaged);
+       if (image) {
+           __fail("hash_table_open_mmap of a truncated image", damaged, cuts[i], -1);
+           hash_table_free(image);
+       }
+   }
+   for (long flip = 0; flip < 72; flip++) {    /* sizeof(struct HashImage) */
+       __damage(path, damaged, size, flip);
+       image = hash_table_open_mmap(damaged);
+       if (image) {
+           __fail("hash_table_open_mmap of a damaged header", damaged, flip, -1);
+           hash_table_free(image);
+       }
+   }
+
+   unlink(path);
+   unlink(resaved);
+   unlink(damaged);
+   rmdir(dir);
+   free(model);
+}
+
+int main(void)
+{
+   for (int k = 0; k < MODEL_KEYS; k++) {
+       snprintf(keys[k], sizeof(keys[k]), "key-%d", k);
+   }
+   __check_model();
+   __check_group_model();
+   __check_batches();
+   __check_freeze();
+   __check_save();
+
+   HashTable *huge = hash_table_create(0x40000001);
+   if (huge) {
+       fprintf(stderr, "FAIL: hash_table_create(0x40000001) succeeded\n");
+       hash_table_free(huge);
+       failures++;
+   }
+   GroupHashTable *huge_group = group_hash_table_create(0x40000001);
+   if (huge_group) {
+       fprintf(stderr, "FAIL: group_hash_table_create(0x40000001) succeeded\n");
+       group_hash_table_free(huge_group);
+       failures++;
+   }
+
+   if (failures) {
+       fprintf(stderr, "%ld failures\n", failures);
+       return 1;
+   }
+   printf("ok\n");
+   return 0;
+}
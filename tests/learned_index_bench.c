@@ -0,0 +1,200 @@
+/*
+ * learned_index_bench.c - Learned index against bisection and the tree indexes
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Reports ns per lookup for binary_search_int(), IntLearnedIndex and, for
+ * reference, the Eytzinger and B+ tree indexes, on three sorted int
+ * distributions: uniform over the int range, skewed (density falling off
+ * as a power law), and clustered (dense runs separated by wide gaps).
+ * Queries are random, nine in ten of them present. Each shape also lists
+ * the learned index's segment count and build time; a run whose answers
+ * disagree on presence with binary_search_int() exits non-zero.
+ *
+ * The library is built without optimization by default; for meaningful
+ * numbers build it with e.g. make CFLAGS="-Wall -O2 -fPIC" bench.
+ *
+ * Usage: learned_index_bench [keys] [queries] [epsilon]
+ */
+
+#include <lookup/array_lookup.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_CLUSTERS        64
+
+struct BenchData {
+   int *arr;
+   int size;
+   int *queries;
+   int query_count;
+   long present;         /* queries binary_search_int() finds */
+};
+
+static volatile long sink;
+
+static double __now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int __compare_int(const void *a, const void *b)
+{
+   int x = *(const int *)a, y = *(const int *)b;
+   return x < y ? -1 : x > y;
+}
+
+/* A uniform double in [0, 1). */
+static double __uniform(unsigned int *seed)
+{
+   return (rand_r(seed) * ((double)RAND_MAX + 1) + rand_r(seed))
+          / (((double)RAND_MAX + 1) * ((double)RAND_MAX + 1));
+}
+
+/* 0 uniform, 1 skewed, 2 clustered. */
+static void __fill(struct BenchData *data, int shape, unsigned int *seed)
+{
+   int cluster_width = data->size / BENCH_CLUSTERS * 4 + 1;
+   for (int i = 0; i < data->size; i++) {
+       double u = __uniform(seed);
+       if (shape == 0) {
+           data->arr[i] = (int)(u * INT_MAX);
+       } else if (shape == 1) {
+           data->arr[i] = (int)(pow(u, 6) * INT_MAX);
+       } else {
+           int cluster = rand_r(seed) % BENCH_CLUSTERS;
+           long start = (long)cluster * (INT_MAX / BENCH_CLUSTERS);
+           data->arr[i] = (int)(start + (long)(u * cluster_width));
+       }
+   }
+   qsort(data->arr, data->size, sizeof(int), __compare_int);
+
+   data->present = 0;
+   for (int q = 0; q < data->query_count; q++) {
+       int target = data->arr[rand_r(seed) % data->size];
+       if (rand_r(seed) % 10 == 0) {
+           target = (int)(__uniform(seed) * INT_MAX);
+       }
+       data->queries[q] = target;
+       data->present += binary_search_int(data->arr, data->size, target) != -1;
+   }
+}
+
+static int __learned_find(const void *index, int *arr, int size, int target)
+{
+   (void)arr;
+   (void)size;
+   return int_learned_index_find(index, target);
+}
+
+static int __bisect_find(const void *index, int *arr, int size, int target)
+{
+   (void)index;
+   return binary_search_int(arr, size, target);
+}
+
+static int __eytzinger_find(const void *index, int *arr, int size, int target)
+{
+   (void)arr;
+   (void)size;
+   return int_search_index_find(index, target);
+}
+
+static int __btree_find(const void *index, int *arr, int size, int target)
+{
+   (void)arr;
+   (void)size;
+   return int_btree_index_find(index, target);
+}
+
+/* ns per lookup; -1 if the answers disagree on presence with bisection. */
+static double __measure(const struct BenchData *data, const void *index,
+                        int (*find)(const void *, int *, int, int))
+{
+   long present = 0;
+   double start = __now();
+   for (int q = 0; q < data->query_count; q++) {
+       present += find(index, data->arr, data->size, data->queries[q]) != -1;
+   }
+   double elapsed = __now() - start;
+   sink = present;
+   return present == data->present ? elapsed * 1e9 / data->query_count : -1;
+}
+
+int main(int argc, char **argv)
+{
+   int size = argc > 1 ? atoi(argv[1]) : 1000000;
+   int query_count = argc > 2 ? atoi(argv[2]) : 1000000;
+   int epsilon = argc > 3 ? atoi(argv[3]) : 0;
+   if (size < 1 || query_count < 1) {
+       fprintf(stderr, "usage: %s [keys] [queries] [epsilon]\n", argv[0]);
+       return 2;
+   }
+   static const char *shapes[] = { "uniform", "skewed", "clustered" };
+   struct BenchData data = { .size = size, .query_count = query_count };
+   data.arr = malloc(sizeof(int) * size);
+   data.queries = malloc(sizeof(int) * query_count);
+   if (!data.arr || !data.queries) {
+       fprintf(stderr, "out of memory\n");
+       return 1;
+   }
+
+   printf("%d keys, %d queries, epsilon %d\n", size, query_count,
+          epsilon > 0 ? epsilon : LEARNED_INDEX_EPSILON);
+   printf("%-10s %9s %9s %12s %10s %10s %10s\n", "shape", "segments", "build ms",
+          "bisect ns", "learned ns", "eytz ns", "btree ns");
+   unsigned int seed = 42;
+   int failed = 0;
+   for (int shape = 0; shape < 3; shape++) {
+       __fill(&data, shape, &seed);
+       double start = __now();
+       IntLearnedIndex *learned = int_learned_index_build(data.arr, size, epsilon);
+       double build_ms = (__now() - start) * 1e3;
+       IntSearchIndex *eytzinger = int_search_index_build(data.arr, size);
+       IntBTreeIndex *btree = int_btree_index_build(data.arr, size, 0);
+       if (!learned || !eytzinger || !btree) {
+           fprintf(stderr, "out of memory\n");
+           return 1;
+       }
+       double bisect = __measure(&data, NULL, __bisect_find);
+       double learn = __measure(&data, learned, __learned_find);
+       double eytz = __measure(&data, eytzinger, __eytzinger_find);
+       double tree = __measure(&data, btree, __btree_find);
+       printf("%-10s %9d %9.1f %12.1f %10.1f %10.1f %10.1f\n", shapes[shape],
+              learned->segment_count, build_ms, bisect, learn, eytz, tree);
+       failed |= learn < 0 || eytz < 0 || tree < 0;
+       int_learned_index_free(learned);
+       int_search_index_free(eytzinger);
+       int_btree_index_free(btree);
+   }
+   free(data.arr);
+   free(data.queries);
+   if (failed) {
+       fprintf(stderr, "FAIL: an index disagreed with binary_search_int (shown as -1.0)\n");
+       return 1;
+   }
+   return 0;
+}
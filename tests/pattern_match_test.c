@@ -0,0 +1,307 @@
+/*
+ * pattern_match_test.c - Multi-pattern matcher against a per-offset reference
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compiles pattern sets on both sides of the Teddy limit, up to one large
+ * enough over a wide alphabet to need the sparse Aho-Corasick automaton,
+ * with repeats, the empty pattern, one-byte patterns and patterns that
+ * overlap, nest in and run past each other. Texts drawn from the same
+ * bytes, with planted copies and NULs, at short lengths around the
+ * 16-byte window and one long length, are scanned, and the reported
+ * (pattern, offset) pairs must equal the set found by comparing every
+ * pattern at every offset. A callback stopping the scan early must make
+ * it return that many matches, and scanning a file must report the same
+ * count as scanning its bytes.
+ *
+ * Usage: pattern_match_test
+ */
+
+#include <lookup/pattern_lookup.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PATTERN_MAX           24
+#define TEXT_LONG             (1 << 16)
+
+struct PatternSet {
+   int count;
+   int min_len;
+   int max_len;
+   int alphabet;     /* distinct bytes the patterns and texts use */
+};
+
+static const struct PatternSet sets[] = {
+   { 1, 1, 4, 4 },
+   { 2, 1, 3, 3 },
+   { 8, 1, 6, 6 },
+   { 33, 2, 20, 8 },
+   { 64, 3, 9, 12 },
+   { 65, 1, 9, 12 },
+   { 500, 2, 12, 20 },
+   { 20000, 4, 16, 120 }
+};
+
+struct Match {
+   size_t offset;
+   int pattern;
+};
+
+struct Collect {
+   struct Match *matches;
+   long count;
+   long capacity;
+   long stop_at;
+};
+
+static long failures;
+
+static void __fail(const char *what, int set, size_t len, long got, long want)
+{
+   if (failures++ < 20) {
+       fprintf(stderr, "FAIL: %s (set %d, text %zu): got %ld, expected %ld\n",
+               what, set, len, got, want);
+   }
+}
+
+static unsigned char __byte(int alphabet, unsigned int *seed)
+{
+   /* Skip NUL, which cannot occur in a pattern. */
+   return (unsigned char)(1 + (rand_r(seed) % alphabet) * 2);
+}
+
+static int __match_cmp(const void *a, const void *b)
+{
+   const struct Match *x = a, *y = b;
+   if (x->offset != y->offset) {
+       return x->offset < y->offset ? -1 : 1;
+   }
+   return (x->pattern > y->pattern) - (x->pattern < y->pattern);
+}
+
+static int __collect(int pattern, size_t offset, void *ctx)
+{
+   struct Collect *c = ctx;
+   if (c->count == c->capacity) {
+       c->capacity = c->capacity ? c->capacity * 2 : 1024;
+       c->matches = realloc(c->matches, sizeof(struct Match) * c->capacity);
+       if (!c->matches) {
+           fprintf(stderr, "out of memory\n");
+           exit(1);
+       }
+   }
+   c->matches[c->count].offset = offset;
+   c->matches[c->count].pattern = pattern;
+   return ++c->count == c->stop_at;
+}
+
+/* Patterns ordered by length, then bytes, for the per-offset reference. */
+static const char **sort_patterns;
+
+static int __pattern_cmp(const void *a, const void *b)
+{
+   int x = *(const int *)a, y = *(const int *)b;
+   size_t lx = strlen(sort_patterns[x]), ly = strlen(sort_patterns[y]);
+   if (lx != ly) {
+       return lx < ly ? -1 : 1;
+   }
+   int c = strcmp(sort_patterns[x], sort_patterns[y]);
+   return c != 0 ? c : (x > y) - (x < y);
+}
+
+/* Every pattern occurring at every offset, found by bisecting per length. */
+static void __reference(const char **patterns, const int *order, int count,
+                        const unsigned char *text, size_t len, struct Collect *out)
+{
+   int groups[PATTERN_MAX + 1];
+   size_t group_len[PATTERN_MAX];
+   int group_count = 0;
+   for (int i = 0; i < count; i++) {
+       size_t plen = strlen(patterns[order[i]]);
+       if (plen > 0 && (group_count == 0 || group_len[group_count - 1] != plen)) {
+           group_len[group_count] = plen;
+           groups[group_count++] = i;
+       }
+   }
+   groups[group_count] = count;
+   for (size_t pos = 0; pos < len; pos++) {
+       for (int g = 0; g < group_count && group_len[g] <= len - pos; g++) {
+           size_t plen = group_len[g];
+           int a = groups[g], b = groups[g + 1];
+           while (a < b) {
+               int mid = a + (b - a) / 2;
+               if (memcmp(patterns[order[mid]], text + pos, plen) < 0) {
+                   a = mid + 1;
+               } else {
+                   b = mid;
+               }
+           }
+           for (; a < groups[g + 1] && memcmp(patterns[order[a]], text + pos, plen) == 0; a++) {
+               __collect(order[a], pos, out);
+           }
+       }
+   }
+}
+
+static void __check_text(const PatternMatcher *matcher, const char **patterns, const int *order,
+                         int count, const unsigned char *text, size_t len, int set)
+{
+   struct Collect want = { 0 }, got = { 0 };
+   __reference(patterns, order, count, text, len, &want);
+   long reported = pattern_matcher_scan(matcher, text, len, __collect, &got);
+   if (reported != got.count || reported != want.count) {
+       __fail("match count", set, len, reported, want.count);
+   } else {
+       qsort(got.matches, got.count, sizeof(struct Match), __match_cmp);
+       qsort(want.matches, want.count, sizeof(struct Match), __match_cmp);
+       for (long i = 0; i < got.count; i++) {
+           if (got.matches[i].offset != want.matches[i].offset
+               || got.matches[i].pattern != want.matches[i].pattern) {
+               __fail("pattern matched at offset", set, len, got.matches[i].pattern,
+                      want.matches[i].pattern);
+               break;
+           }
+       }
+   }
+   if (want.count > 1) {
+       struct Collect stopped = { 0 };
+       stopped.stop_at = 1 + want.count / 2;
+       reported = pattern_matcher_scan(matcher, text, len, __collect, &stopped);
+       if (reported != stopped.stop_at || stopped.count != stopped.stop_at) {
+           __fail("matches before stopping", set, len, reported, stopped.stop_at);
+       }
+       free(stopped.matches);
+   }
+   free(want.matches);
+   free(got.matches);
+}
+
+static void __check_file(const PatternMatcher *matcher, const unsigned char *text, size_t len,
+                         long want, int set)
+{
+   char path[] = "/tmp/pattern_match_test.XXXXXX";
+   int fd = mkstemp(path);
+   if (fd == -1 || write(fd, text, len) != (ssize_t)len) {
+       fprintf(stderr, "FAIL: cannot write %s\n", path);
+       failures++;
+       if (fd != -1) {
+           close(fd);
+           unlink(path);
+       }
+       return;
+   }
+   close(fd);
+   struct Collect got = { 0 };
+   long reported = pattern_matcher_scan_file(matcher, path, __collect, &got);
+   if (reported != want) {
+       __fail("file match count", set, len, reported, want);
+   }
+   free(got.matches);
+   unlink(path);
+   if (pattern_matcher_scan_file(matcher, path, __collect, &got) != -1) {
+       __fail("scan of a missing file", set, len, 0, -1);
+   }
+}
+
+int main(void)
+{
+   unsigned int seed = 12345;
+   unsigned char *text = malloc(TEXT_LONG);
+   if (!text) {
+       fprintf(stderr, "out of memory\n");
+       return 1;
+   }
+   for (size_t s = 0; s < sizeof(sets) / sizeof(sets[0]); s++) {
+       const struct PatternSet *set = &sets[s];
+       char (*storage)[PATTERN_MAX] = malloc(PATTERN_MAX * set->count);
+       const char **patterns = malloc(sizeof(char *) * set->count);
+       int *order = malloc(sizeof(int) * set->count);
+       if (!storage || !patterns || !order) {
+           fprintf(stderr, "out of memory\n");
+           return 1;
+       }
+       for (int i = 0; i < set->count; i++) {
+           int len = set->min_len + rand_r(&seed) % (set->max_len - set->min_len + 1);
+           if (i > 0 && rand_r(&seed) % 10 == 0) {
+               /* A repeat, or a prefix or suffix of an earlier pattern. */
+               const char *other = storage[rand_r(&seed) % i];
+               size_t olen = strlen(other);
+               size_t cut = rand_r(&seed) % (olen + 1);
+               strcpy(storage[i], rand_r(&seed) % 2 ? other + cut : other);
+               if (rand_r(&seed) % 3 == 0) {
+                   storage[i][cut] = '\0';
+               }
+           } else {
+               for (int j = 0; j < len; j++) {
+                   storage[i][j] = (char)__byte(set->alphabet, &seed);
+               }
+               storage[i][len] = '\0';
+           }
+           patterns[i] = storage[i];
+           order[i] = i;
+       }
+       if (set->count > 2) {
+           storage[set->count / 2][0] = '\0';
+       }
+       sort_patterns = patterns;
+       qsort(order, set->count, sizeof(int), __pattern_cmp);
+
+       PatternMatcher *matcher = pattern_matcher_build(patterns, set->count);
+       if (!matcher) {
+           fprintf(stderr, "FAIL: cannot build a matcher of %d patterns\n", set->count);
+           return 1;
+       }
+       for (int round = 0; round <= 40; round++) {
+           size_t n = round < 40 ? (size_t)round : TEXT_LONG;
+           for (size_t i = 0; i < n; i++) {
+               text[i] = rand_r(&seed) % 64 == 0 ? 0 : __byte(set->alphabet, &seed);
+           }
+           /* Plant copies, some running into the end of the text. */
+           for (size_t k = 0; k < n / 32 + 2; k++) {
+               const char *p = patterns[rand_r(&seed) % set->count];
+               size_t plen = strlen(p);
+               if (plen > n) {
+                   continue;
+               }
+               size_t at = k == 0 ? n - plen : rand_r(&seed) % (n - plen + 1);
+               memcpy(text + at, p, plen);
+           }
+           __check_text(matcher, patterns, order, set->count, text, n, (int)s);
+       }
+       struct Collect all = { 0 };
+       long want = pattern_matcher_scan(matcher, text, TEXT_LONG, __collect, &all);
+       free(all.matches);
+       __check_file(matcher, text, TEXT_LONG, want, (int)s);
+       pattern_matcher_free(matcher);
+       free(storage);
+       free(patterns);
+       free(order);
+   }
+   free(text);
+   if (failures) {
+       fprintf(stderr, "%ld failures\n", failures);
+       return 1;
+   }
+   printf("ok\n");
+   return 0;
+}
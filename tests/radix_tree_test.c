@@ -0,0 +1,232 @@
+/*
+ * radix_tree_test.c - Adaptive radix tree against a sorted reference
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Builds trees from unsorted key sets with repeats, the empty string,
+ * keys that are prefixes of other keys, long shared paths and bytes
+ * above 0x7f, at sizes that produce every node type, and checks every
+ * answer against a strcmp-sorted copy of the keys. An exact lookup must
+ * return the first index of an equal key; a longest-prefix lookup the
+ * first index of the longest key the query starts with; and a prefix
+ * enumeration must visit each distinct matching key once, in strcmp
+ * order, and stop right after the callback asks it to. Queries are
+ * every key, its truncations and extensions, and random strings.
+ *
+ * Usage: radix_tree_test
+ */
+
+#include <lookup/radix_tree_lookup.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEY_MAX               40
+
+static const int sizes[] = { 0, 1, 2, 3, 4, 5, 16, 17, 48, 49, 200, 1000, 5000 };
+
+struct Entry {
+   const char *key;
+   int index;
+};
+
+struct Visit {
+   const struct Entry *expected;
+   int count;
+   int seen;
+   int stop_at;
+   const char *prefix;
+};
+
+static long failures;
+
+static void __fail(const char *what, const char *query, long got, long want)
+{
+   if (failures++ < 20) {
+       fprintf(stderr, "FAIL: %s \"%s\": got %ld, expected %ld\n", what, query, got, want);
+   }
+}
+
+static int __entry_cmp(const void *a, const void *b)
+{
+   const struct Entry *x = a, *y = b;
+   int c = strcmp(x->key, y->key);
+   return c != 0 ? c : (x->index > y->index) - (x->index < y->index);
+}
+
+/* Keys over a few letters, so paths branch and share; some reach 0xff. */
+static void __random_key(char *buf, unsigned int *seed)
+{
+   static const char *const stems[] = { "", "", "a", "node/path/shared/", "\xc3\xa9t\xc3\xa9" };
+   static const char alphabet[] = "abcdz0\x80\xff";
+   strcpy(buf, stems[rand_r(seed) % 5]);
+   size_t len = strlen(buf);
+   int extra = rand_r(seed) % 12;
+   for (int i = 0; i < extra; i++) {
+       /* Occasionally draw from the full byte range for wide nodes. */
+       buf[len++] = rand_r(seed) % 8 == 0 ? (char)(1 + rand_r(seed) % 255)
+                                          : alphabet[rand_r(seed) % (sizeof(alphabet) - 1)];
+   }
+   buf[len] = '\0';
+}
+
+/* The first entry not below 'key', in the sorted distinct entries. */
+static int __lower_bound(const struct Entry *sorted, int count, const char *key)
+{
+   int lo = 0, hi = count;
+   while (lo < hi) {
+       int mid = lo + (hi - lo) / 2;
+       if (strcmp(sorted[mid].key, key) < 0) {
+           lo = mid + 1;
+       } else {
+           hi = mid;
+       }
+   }
+   return lo;
+}
+
+static int __exact(const struct Entry *sorted, int count, const char *key)
+{
+   int i = __lower_bound(sorted, count, key);
+   return i < count && strcmp(sorted[i].key, key) == 0 ? sorted[i].index : -1;
+}
+
+static int __visit(const char *key, int index, void *ctx)
+{
+   struct Visit *v = ctx;
+   if (v->seen >= v->count) {
+       __fail("prefix_each visited an extra key", v->prefix, index, -1);
+   } else if (index != v->expected[v->seen].index || strcmp(key, v->expected[v->seen].key) != 0) {
+       __fail("prefix_each visited", v->prefix, index, v->expected[v->seen].index);
+   }
+   return ++v->seen == v->stop_at;
+}
+
+static void __check_query(const RadixTree *tree, const struct Entry *sorted, int count,
+                          const char *query, unsigned int *seed)
+{
+   int want = __exact(sorted, count, query);
+   int got = radix_tree_lookup(tree, query);
+   if (got != want) {
+       __fail("lookup", query, got, want);
+   }
+
+   char buf[KEY_MAX * 2];
+   size_t len = strlen(query);
+   memcpy(buf, query, len + 1);
+   want = -1;
+   for (size_t n = len + 1; n-- > 0 && want < 0;) {
+       buf[n] = '\0';
+       want = __exact(sorted, count, buf);
+   }
+   got = radix_tree_longest_prefix(tree, query);
+   if (got != want) {
+       __fail("longest_prefix", query, got, want);
+   }
+
+   int first = __lower_bound(sorted, count, query);
+   int matches = 0;
+   while (first + matches < count && strncmp(sorted[first + matches].key, query, len) == 0) {
+       matches++;
+   }
+   struct Visit v = { sorted + first, matches, 0, 0, query };
+   got = radix_tree_prefix_each(tree, query, __visit, &v);
+   if (got != matches || v.seen != matches) {
+       __fail("prefix_each count", query, got, matches);
+   }
+   if (matches > 1) {
+       v.seen = 0;
+       v.stop_at = 1 + rand_r(seed) % (matches - 1);
+       got = radix_tree_prefix_each(tree, query, __visit, &v);
+       if (got != v.stop_at || v.seen != v.stop_at) {
+           __fail("prefix_each stopped after", query, got, v.stop_at);
+       }
+   }
+}
+
+int main(void)
+{
+   unsigned int seed = 12345;
+   int max_size = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+   char (*keys)[KEY_MAX] = malloc(KEY_MAX * max_size);
+   const char **arr = malloc(sizeof(char *) * max_size);
+   struct Entry *sorted = malloc(sizeof(struct Entry) * max_size);
+   if (!keys || !arr || !sorted) {
+       fprintf(stderr, "out of memory\n");
+       return 1;
+   }
+   for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+       int size = sizes[s];
+       for (int i = 0; i < size; i++) {
+           if (i > 0 && rand_r(&seed) % 8 == 0) {
+               strcpy(keys[i], keys[rand_r(&seed) % i]);
+           } else if (i > 0 && rand_r(&seed) % 8 == 0) {
+               /* A truncation of an earlier key. */
+               strcpy(keys[i], keys[rand_r(&seed) % i]);
+               keys[i][strlen(keys[i]) / 2] = '\0';
+           } else {
+               __random_key(keys[i], &seed);
+           }
+           arr[i] = keys[i];
+           sorted[i].key = keys[i];
+           sorted[i].index = i;
+       }
+       qsort(sorted, size, sizeof(struct Entry), __entry_cmp);
+       int count = 0;
+       for (int i = 0; i < size; i++) {
+           if (count == 0 || strcmp(sorted[count - 1].key, sorted[i].key) != 0) {
+               sorted[count++] = sorted[i];
+           }
+       }
+
+       RadixTree *tree = radix_tree_build(arr, size);
+       if (!tree) {
+           fprintf(stderr, "FAIL: cannot build a tree of %d keys\n", size);
+           return 1;
+       }
+       char query[KEY_MAX * 2];
+       __check_query(tree, sorted, count, "", &seed);
+       for (int i = 0; i < size; i++) {
+           size_t len = strlen(keys[i]);
+           __check_query(tree, sorted, count, keys[i], &seed);
+           for (size_t n = 1; n < len; n += 1 + len / 4) {
+               memcpy(query, keys[i], n);
+               query[n] = '\0';
+               __check_query(tree, sorted, count, query, &seed);
+           }
+           memcpy(query, keys[i], len);
+           query[len] = "a\x80z\xff"[i % 4];
+           query[len + 1] = '\0';
+           __check_query(tree, sorted, count, query, &seed);
+           __random_key(query, &seed);
+           __check_query(tree, sorted, count, query, &seed);
+       }
+       radix_tree_free(tree);
+   }
+   free(keys);
+   free(arr);
+   free(sorted);
+   if (failures) {
+       fprintf(stderr, "%ld failures\n", failures);
+       return 1;
+   }
+   printf("ok\n");
+   return 0;
+}
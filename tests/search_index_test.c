@@ -0,0 +1,165 @@
+/*
+ * search_index_test.c - Sorted-array search indexes against plain bisection
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Builds the Eytzinger, B+ tree and learned indexes over sorted arrays
+ * of sizes around their node and level boundaries, with distinct keys,
+ * runs of duplicates and the int extremes, and checks every answer
+ * against binary_search_int() and array_lower_bound_int(). A find must agree
+ * with binary_search_int() on whether the target is present and return
+ * its first occurrence; lower_bound and range_count must match the
+ * plain bisections exactly. Queries are every element, its neighbours
+ * and INT_MIN/INT_MAX. An Eytzinger index too large for int slot
+ * numbers must be refused.
+ *
+ * Usage: search_index_test
+ */
+
+#include <lookup/array_lookup.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const int sizes[] = {
+   0, 1, 2, 3, 15, 16, 17, 31, 33, 255, 256, 257, 271, 272, 273,
+   4095, 4096, 4097, 4624, 4625, 65535, 65536, 65537, 100003
+};
+
+static long failures;
+
+/* Sorted data: 0 distinct with gaps, 1 runs of duplicates, 2 extremes. */
+static void __fill(int *arr, int size, int shape, unsigned int *seed)
+{
+   long value = shape == 2 ? INT_MIN : -(long)size;
+   for (int i = 0; i < size; i++) {
+       if (shape == 1 && i > 0 && rand_r(seed) % 4 != 0) {
+           arr[i] = arr[i - 1];
+           continue;
+       }
+       value += 1 + rand_r(seed) % (shape == 2 ? 1 << 20 : 5);
+       arr[i] = value > INT_MAX ? INT_MAX : (int)value;
+   }
+   if (shape == 2 && size > 1) {
+       arr[0] = INT_MIN;
+       arr[size - 1] = INT_MAX;
+   }
+}
+
+static void __fail(const char *what, int size, int shape, int target, long got, long want)
+{
+   if (failures++ < 20) {
+       fprintf(stderr, "FAIL: %s size %d shape %d target %d: got %ld, expected %ld\n",
+               what, size, shape, target, got, want);
+   }
+}
+
+/* A find result is right if it agrees on presence and is the first occurrence. */
+static void __check_find(const char *what, int *arr, int size, int shape, int target, int got)
+{
+   int any = binary_search_int(arr, size, target);
+   size_t first = array_lower_bound_int(arr, size, target);
+   if ((got == -1) != (any == -1) || (got != -1 && (size_t)got != first)) {
+       __fail(what, size, shape, target, got, any == -1 ? -1 : (long)first);
+   }
+}
+
+struct Indexes {
+   IntSearchIndex *eytzinger;
+   IntBTreeIndex *btree;
+   IntLearnedIndex *learned;
+};
+
+static void __check_target(int *arr, int size, int shape, const struct Indexes *ix, int target)
+{
+   __check_find("int_search_index_find", arr, size, shape, target,
+                int_search_index_find(ix->eytzinger, target));
+   __check_find("int_btree_index_find", arr, size, shape, target,
+                int_btree_index_find(ix->btree, target));
+   __check_find("int_learned_index_find", arr, size, shape, target,
+                int_learned_index_find(ix->learned, target));
+
+   size_t lower = array_lower_bound_int(arr, size, target);
+   int got = int_btree_index_lower_bound(ix->btree, target);
+   if ((size_t)got != lower) {
+       __fail("int_btree_index_lower_bound", size, shape, target, got, (long)lower);
+   }
+   if (target < INT_MAX) {
+       size_t upper = array_lower_bound_int(arr, size, target + 1);
+       got = int_btree_index_range_count(ix->btree, target, target + 1);
+       if ((size_t)got != upper - lower) {
+           __fail("int_btree_index_range_count", size, shape, target, got,
+                  (long)(upper - lower));
+       }
+   }
+}
+
+int main(void)
+{
+   unsigned int seed = 12345;
+   int max_size = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+   int *arr = malloc(sizeof(int) * max_size);
+   if (!arr) {
+       fprintf(stderr, "out of memory\n");
+       return 1;
+   }
+   for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+       int size = sizes[s];
+       for (int shape = 0; shape < 3; shape++) {
+           __fill(arr, size, shape, &seed);
+           struct Indexes ix = {
+               int_search_index_build(arr, size),
+               int_btree_index_build(arr, size, 0),
+               int_learned_index_build(arr, size, 0)
+           };
+           if (!ix.eytzinger || !ix.btree || !ix.learned) {
+               fprintf(stderr, "FAIL: cannot build indexes of size %d\n", size);
+               return 1;
+           }
+           __check_target(arr, size, shape, &ix, INT_MIN);
+           __check_target(arr, size, shape, &ix, INT_MAX);
+           for (int i = 0; i < size; i++) {
+               __check_target(arr, size, shape, &ix, arr[i]);
+               if (arr[i] > INT_MIN) {
+                   __check_target(arr, size, shape, &ix, arr[i] - 1);
+               }
+               if (arr[i] < INT_MAX) {
+                   __check_target(arr, size, shape, &ix, arr[i] + 1);
+               }
+           }
+           int_search_index_free(ix.eytzinger);
+           int_btree_index_free(ix.btree);
+           int_learned_index_free(ix.learned);
+       }
+   }
+   free(arr);
+
+   /* Past 2^30 - 1 keys the Eytzinger slot numbers would overflow an int. */
+   if (int_search_index_build(NULL, 1 << 30) || float_search_index_build(NULL, 1 << 30)) {
+       fprintf(stderr, "FAIL: Eytzinger index of 2^30 keys was built\n");
+       failures++;
+   }
+   if (failures) {
+       fprintf(stderr, "%ld failures\n", failures);
+       return 1;
+   }
+   printf("ok\n");
+   return 0;
+}
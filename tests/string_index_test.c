@@ -0,0 +1,159 @@
+/*
+ * string_index_test.c - Front-coded sorted string index against bisection
+ *
+ * liblookup - a platform-independent runtime and static lookup library
+ *
+ * Copyright (c) 2025 Impact Tiling Group Pty Ltd.
+ * All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Builds SortedStringIndex over strcmp-sorted dictionaries around the
+ * 16-entry block boundaries, with repeats, the empty string, keys shorter
+ * than the 8-byte inline prefix, long runs sharing that prefix and bytes
+ * above 0x7f, and checks every find against a plain strcmp bisection: it
+ * must return the first equal position, or -1. Queries are every key,
+ * its truncations around the inline length, its extensions, the key with
+ * its last byte bumped up or down, and random strings.
+ *
+ * Usage: string_index_test
+ */
+
+#include <lookup/string_lookup.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEY_MAX               48
+
+static const int sizes[] = { 0, 1, 2, 15, 16, 17, 31, 32, 33, 100, 1000, 50000 };
+
+static long failures;
+
+static void __fail(const char *query, int size, int got, int want)
+{
+   if (failures++ < 20) {
+       fprintf(stderr, "FAIL: find \"%s\" in %d keys: got %d, expected %d\n",
+               query, size, got, want);
+   }
+}
+
+static int __string_cmp(const void *a, const void *b)
+{
+   return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/* Stems put many keys on one 8-byte inline prefix, or under it. */
+static void __random_key(char *buf, unsigned int *seed)
+{
+   static const char *const stems[] = {
+       "", "ab", "prefix__", "com.example.service.", "com.example.service.v2.", "\xff\xfe\xfd\xfc"
+   };
+   static const char alphabet[] = "abz09.\x01\x80\xff";
+   strcpy(buf, stems[rand_r(seed) % 6]);
+   size_t len = strlen(buf);
+   int extra = rand_r(seed) % 14;
+   for (int i = 0; i < extra; i++) {
+       buf[len++] = alphabet[rand_r(seed) % (sizeof(alphabet) - 1)];
+   }
+   buf[len] = '\0';
+}
+
+static int __reference(const char **arr, int size, const char *target)
+{
+   int lo = 0, hi = size;
+   while (lo < hi) {
+       int mid = lo + (hi - lo) / 2;
+       if (strcmp(arr[mid], target) < 0) {
+           lo = mid + 1;
+       } else {
+           hi = mid;
+       }
+   }
+   return lo < size && strcmp(arr[lo], target) == 0 ? lo : -1;
+}
+
+static void __check(const SortedStringIndex *index, const char **arr, int size, const char *query)
+{
+   int want = __reference(arr, size, query);
+   int got = sorted_string_index_find(index, query);
+   if (got != want) {
+       __fail(query, size, got, want);
+   }
+}
+
+int main(void)
+{
+   unsigned int seed = 12345;
+   int max_size = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+   char (*keys)[KEY_MAX] = malloc(KEY_MAX * max_size);
+   const char **arr = malloc(sizeof(char *) * max_size);
+   if (!keys || !arr) {
+       fprintf(stderr, "out of memory\n");
+       return 1;
+   }
+   for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+       int size = sizes[s];
+       for (int i = 0; i < size; i++) {
+           if (i > 0 && rand_r(&seed) % 6 == 0) {
+               strcpy(keys[i], keys[rand_r(&seed) % i]);
+           } else {
+               __random_key(keys[i], &seed);
+           }
+           arr[i] = keys[i];
+       }
+       qsort(arr, size, sizeof(char *), __string_cmp);
+
+       SortedStringIndex *index = sorted_string_index_build(arr, size);
+       if (!index) {
+           fprintf(stderr, "FAIL: cannot build an index of %d keys\n", size);
+           return 1;
+       }
+       char query[KEY_MAX + 2];
+       __check(index, arr, size, "");
+       __check(index, arr, size, "\xff\xff\xff\xff\xff\xff\xff\xff\xff");
+       for (int i = 0; i < size; i++) {
+           size_t len = strlen(arr[i]);
+           __check(index, arr, size, arr[i]);
+           for (size_t n = 1; n < len; n += n >= 6 && n <= 9 ? 1 : 3) {
+               memcpy(query, arr[i], n);
+               query[n] = '\0';
+               __check(index, arr, size, query);
+           }
+           memcpy(query, arr[i], len + 1);
+           if (len > 0) {
+               query[len - 1]++;
+               __check(index, arr, size, query);
+               query[len - 1] -= 2;
+               __check(index, arr, size, query);
+               query[len - 1]++;
+           }
+           query[len] = "a\x01\xff"[i % 3];
+           query[len + 1] = '\0';
+           __check(index, arr, size, query);
+           __random_key(query, &seed);
+           __check(index, arr, size, query);
+       }
+       sorted_string_index_free(index);
+   }
+   free(keys);
+   free(arr);
+   if (failures) {
+       fprintf(stderr, "%ld failures\n", failures);
+       return 1;
+   }
+   printf("ok\n");
+   return 0;
+}